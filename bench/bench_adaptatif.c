@@ -0,0 +1,92 @@
+/* Banc d'essai de l'échantillonnage adaptatif (--adaptive) : erreur
+ * quadratique moyenne (RMSE) par rapport à une image de référence, pour le
+ * même nombre total d'échantillons qu'un rendu uniforme, puis à temps égal
+ * (les échantillons des pixels difficiles, sous les sphères de verre,
+ * coûtent plus de rayons que ceux du mur du fond).
+ *
+ * L'erreur est mesurée après la correction gamma de toInt() (x^(1/2.2)) :
+ * c'est l'image qu'on regarde, et une erreur relative y donne à peu près la
+ * même erreur absolue dans les zones sombres et claires. La référence
+ * utilise des échantillons à partir de REF_DECALAGE, indépendants de ceux
+ * des rendus mesurés.
+ *
+ * usage : ./bench_adaptatif [--nee] [scène [largeur [échantillons de la référence]]]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adaptatif.h"
+#include "blas.h"
+#include "render.h"
+#include "scene.h"
+
+#include "commun.h"
+
+/* rend l'image (samples échantillons par sous-pixel partout) ; renvoie le temps de calcul */
+static double rendu(const struct scene *sc, const struct camera *cam, int samples, double *image)
+{
+	double debut = wtime();
+	for (int i = 0; i < cam->h; i++)
+		for (int j = 0; j < cam->w; j++)
+			render_pixel(sc, cam, i, j, samples, image + 3 * (i * cam->w + j));
+	return wtime() - debut;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && strcmp(argv[1], "--nee") == 0) {
+		render_nee = true;
+		argc--;
+		argv++;
+	}
+	const char *fichier_scene = (argc > 1 && argv[1][0] != '\0') ? argv[1] : NULL;
+	int w = (argc > 2) ? atoi(argv[2]) : 80;
+	int h = w * 5 / 8;
+	int s_ref = (argc > 3) ? atoi(argv[3]) : 256;
+	int n = w * h;
+
+	struct scene sc;
+	scene_load(&sc, fichier_scene);
+	struct camera cam;
+	camera_init(&cam, w, h);
+
+	double *ref = malloc(3 * n * sizeof(double));
+	double *image = malloc(3 * n * sizeof(double));
+	struct pixel_stats *stats = malloc(n * sizeof(*stats));
+	if (ref == NULL || image == NULL || stats == NULL) {
+		perror("Impossible d'allouer les images");
+		exit(1);
+	}
+
+	printf("# %s%s, %d x %d, référence à %d échantillons par sous-pixel\n",
+			fichier_scene ? fichier_scene : "Cornell", render_nee ? " (--nee)" : "", w, h, s_ref);
+	double debut = wtime();
+	rendu_echantillons(&sc, &cam, s_ref, REF_DECALAGE, ref);
+	printf("# référence : %.1f s\n", wtime() - debut);
+
+	printf("%11s %10s %10s %10s %10s %18s %8s\n", "échantillons", "temps", "RMSE", "temps adapt.",
+			"RMSE adapt.", "RMSE adapt. temps égal", "gain");
+	for (int s = 4; s <= s_ref / 4; s *= 2) {
+		double tu = rendu(&sc, &cam, s, image);
+		double eu = rmse(image, ref, n);
+
+		struct adaptatif ad;
+		adaptatif_defaut(&ad, s, n);
+		debut = wtime();
+		adaptatif_rendu(&sc, &cam, &ad, 0, n, stats, image, NULL);
+		double ta = wtime() - debut;
+		double ea = rmse(image, ref, n);
+		double ea_egal = ea * sqrt(ta / tu);
+		/* gain en temps pour la même erreur : (RMSE / RMSE adaptative à temps égal)² */
+		printf("%11d %9.2fs %10.5f %11.2fs %11.5f %22.5f %7.2fx\n", 4 * s, tu, eu, ta, ea, ea_egal,
+				(eu / ea_egal) * (eu / ea_egal));
+	}
+
+	free(ref);
+	free(image);
+	free(stats);
+	scene_free(&sc);
+	return 0;
+}
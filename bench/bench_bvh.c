@@ -0,0 +1,155 @@
+/* Banc d'essai de la BVH : parcours linéaire (SIMD) contre BVH, pour des
+ * scènes aléatoires de taille croissante. Vérifie au passage que les deux
+ * donnent la même sphère touchée.
+ *
+ * Mesure aussi la construction avec 1 thread et avec tous les threads
+ * (OMP_NUM_THREADS), qui doivent donner le même arbre, et la relecture
+ * depuis le cache (mmap) ; le parcours se fait sur la BVH relue.
+ *
+ * usage : ./bench_bvh [nombre maximal de sphères]
+ */
+#define _XOPEN_SOURCE 600
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "bvh.h"
+#include "scene.h"
+
+#include "commun.h"
+
+#define NB_RAYONS 200000        /* rayons lancés dans la BVH */
+#define BUDGET_LINEAIRE 4e8     /* rayons x sphères pour le parcours linéaire */
+
+/* n sphères réparties dans un cube dont le volume croît avec n (densité constante) */
+static void random_scene(struct Sphere *spheres, int n, double *cote)
+{
+	*cote = 10 * cbrt(n);
+	for (int i = 0; i < n; i++) {
+		spheres[i].radius = 0.5 + 2 * drand48();
+		for (int a = 0; a < 3; a++)
+			spheres[i].position[a] = *cote * drand48();
+		spheres[i].refl = DIFF;
+	}
+}
+
+static void random_rays(double (*o)[3], double (*d)[3], int nb, double cote)
+{
+	for (int k = 0; k < nb; k++) {
+		double z = 2 * drand48() - 1, phi = 2 * M_PI * drand48(), s = sqrt(1 - z * z);
+		for (int a = 0; a < 3; a++)
+			o[k][a] = cote * drand48();
+		d[k][0] = s * cos(phi);
+		d[k][1] = s * sin(phi);
+		d[k][2] = z;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int n_max = (argc == 2) ? atoi(argv[1]) : 1 << 20;
+	double (*o)[3] = malloc(NB_RAYONS * sizeof(*o));
+	double (*d)[3] = malloc(NB_RAYONS * sizeof(*d));
+	struct Sphere *spheres = malloc(n_max * sizeof(struct Sphere));
+	double *radius = malloc(n_max * sizeof(double));
+	if (o == NULL || d == NULL || spheres == NULL || radius == NULL) {
+		perror("Impossible d'allouer la scène");
+		exit(1);
+	}
+	setenv("BVH_CACHE", "", 1);    /* scene_compile() ne doit pas remplir le cache */
+	int nb_threads = 1;
+#ifdef _OPENMP
+	nb_threads = omp_get_max_threads();
+#endif
+	char cache[64];
+	snprintf(cache, sizeof(cache), "/tmp/bench_bvh-%d.bin", (int) getpid());
+	srand48(2019);
+	printf("# parcours linéaire %s contre BVH (SAH binné), construction sur 1 et %d threads\n",
+			scene_simd_name(), nb_threads);
+	printf("%9s %10s %10s %9s %10s %10s %10s %8s %s\n", "sphères", "linéaire", "BVH", "accélér.",
+			"constr. 1", "constr. N", "cache", "noeuds", "(Mrayons/s, ms)");
+	for (int n = 4; n <= n_max; n *= 2) {
+		double cote;
+		random_scene(spheres, n, &cote);
+		random_rays(o, d, NB_RAYONS, cote);
+		struct scene sc;
+		scene_compile(&sc, spheres, n);
+		for (int i = 0; i < n; i++)
+			radius[i] = spheres[i].radius;
+
+		struct bvh seq, par, b;
+#ifdef _OPENMP
+		omp_set_num_threads(1);
+#endif
+		double debut = wtime();
+		bvh_build(&seq, sc.px, sc.py, sc.pz, radius, n);
+		double construction_seq = wtime() - debut;
+#ifdef _OPENMP
+		omp_set_num_threads(nb_threads);
+#endif
+		debut = wtime();
+		bvh_build(&par, sc.px, sc.py, sc.pz, radius, n);
+		double construction_par = wtime() - debut;
+		bool meme_arbre = seq.taille == par.taille && memcmp(seq.bloc, par.bloc, seq.taille) == 0;
+		bvh_free(&seq);
+
+		uint64_t hash = bvh_hash(sc.px, sc.py, sc.pz, radius, n);
+		if (!bvh_save(&par, cache, hash)) {
+			perror("Impossible d'écrire le cache");
+			exit(1);
+		}
+		debut = wtime();
+		if (!bvh_load(&b, cache, hash, n)) {
+			fprintf(stderr, "Impossible de relire le cache\n");
+			exit(1);
+		}
+		double relecture = wtime() - debut;
+		unlink(cache);
+		bvh_free(&par);
+
+		int nb_lin = BUDGET_LINEAIRE / n;
+		nb_lin = (nb_lin > NB_RAYONS) ? NB_RAYONS : ((nb_lin < 1000) ? 1000 : nb_lin);
+		int *id_lin = malloc(nb_lin * sizeof(int));
+		debut = wtime();
+		for (int k = 0; k < nb_lin; k++) {
+			double t;
+			if (!scene_intersect_linear(&sc, o[k], d[k], &t, &id_lin[k]))
+				id_lin[k] = -1;
+		}
+		double lin = nb_lin / (wtime() - debut) / 1e6;
+
+		int erreurs = 0;
+		debut = wtime();
+		for (int k = 0; k < NB_RAYONS; k++) {
+			double t;
+			int id;
+			if (!bvh_intersect(&b, o[k], d[k], &t, &id))
+				id = -1;
+			if (k < nb_lin && id != id_lin[k])
+				erreurs++;
+		}
+		double acc = NB_RAYONS / (wtime() - debut) / 1e6;
+
+		printf("%9d %10.2f %10.2f %8.1fx %10.2f %10.2f %10.3f %8d", n, lin, acc, acc / lin,
+				1e3 * construction_seq, 1e3 * construction_par, 1e3 * relecture, b.nb_nodes);
+		if (!meme_arbre)
+			printf("   arbres séquentiel et parallèle différents !");
+		if (erreurs)
+			printf("   %d rayons différents sur %d !", erreurs, nb_lin);
+		printf("\n");
+		fflush(stdout);
+		free(id_lin);
+		bvh_free(&b);
+		scene_free(&sc);
+	}
+	free(o);
+	free(d);
+	free(spheres);
+	free(radius);
+	return 0;
+}
@@ -0,0 +1,125 @@
+/* Banc d'essai du débruitage (--denoise) : erreur quadratique moyenne
+ * (RMSE, après correction gamma) par rapport à une image de référence,
+ * avant et après le filtre, et nombre d'échantillons qu'il faudrait sans
+ * filtre pour la même erreur (interpolée en log-log sur la RMSE mesurée des
+ * rendus bruts : avec la correction gamma et les sous-pixels bornés, elle
+ * baisse moins vite que 1 / sqrt(N) aux petits N).
+ *
+ * La référence est la moyenne de deux moitiés indépendantes A et B : leur
+ * écart donne le bruit qui lui reste (RMSE(A, B)² / 4), retiré des erreurs
+ * mesurées pour qu'il ne masque pas celle des images filtrées.
+ *
+ * Vérifie aussi que le découpage en tuiles ne change pas le résultat :
+ * une seule tuile couvrant toute l'image doit donner les mêmes octets que
+ * denoise_image().
+ *
+ * usage : ./bench_denoise [--nee] [scène [largeur [échantillons de la référence]]]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "blas.h"
+#include "denoise.h"
+#include "render.h"
+#include "scene.h"
+
+#include "commun.h"
+
+/* RMSE par rapport à l'image exacte : on retire le bruit de la référence */
+static double rmse_corrigee(const double *a, const double *ref, int n, double bruit_ref)
+{
+	double e = rmse(a, ref, n);
+	return sqrt(fmax(e * e - bruit_ref * bruit_ref, 0));
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && strcmp(argv[1], "--nee") == 0) {
+		render_nee = true;
+		argc--;
+		argv++;
+	}
+	const char *fichier_scene = (argc > 1 && argv[1][0] != '\0') ? argv[1] : NULL;
+	int w = (argc > 2) ? atoi(argv[2]) : 160;
+	int h = w * 5 / 8;
+	int s_ref = (argc > 3) ? atoi(argv[3]) : 256;
+	int n = w * h;
+
+	struct scene sc;
+	scene_load(&sc, fichier_scene);
+	struct camera cam;
+	camera_init(&cam, w, h);
+
+	double *ref = malloc(3 * n * sizeof(double));
+	double *image = malloc(3 * n * sizeof(double));
+	double *filtree = malloc(3 * n * sizeof(double));
+	double *une_tuile = malloc(3 * n * sizeof(double));
+	double *moitie = malloc(3 * n * sizeof(double));
+	if (ref == NULL || image == NULL || filtree == NULL || une_tuile == NULL || moitie == NULL) {
+		perror("Impossible d'allouer les images");
+		exit(1);
+	}
+
+	printf("# %s%s, %d x %d, référence à %d échantillons par sous-pixel\n",
+			fichier_scene ? fichier_scene : "Cornell", render_nee ? " (--nee)" : "", w, h, s_ref);
+	double debut = wtime();
+	rendu_echantillons(&sc, &cam, s_ref / 2, REF_DECALAGE, ref);
+	rendu_echantillons(&sc, &cam, s_ref / 2, REF_DECALAGE + s_ref / 2, moitie);
+	double bruit_ref = rmse(ref, moitie, n) / 2;
+	for (int k = 0; k < 3 * n; k++)
+		ref[k] = (ref[k] + moitie[k]) / 2;
+	printf("# référence : %.1f s, bruit %.5f\n", wtime() - debut, bruit_ref);
+
+	struct gbuffer gb;
+	debut = wtime();
+	gbuffer_init(&gb, &sc, &cam, false);
+	printf("# tampons de guidage : %.3f s\n", wtime() - debut);
+	struct denoise dn;
+	denoise_defaut(&dn);
+
+	/* rendus bruts puis filtrés, N = 4, 8, ... s_ref échantillons par pixel */
+	int nb = 0;
+	double er[32], ef[32], tr[32], tf[32];
+	bool identiques = true;
+	for (int s = 1; s <= s_ref / 4; s *= 2, nb++) {
+		debut = wtime();
+		rendu_echantillons(&sc, &cam, s, 0, image);
+		tr[nb] = wtime() - debut;
+		er[nb] = rmse_corrigee(image, ref, n, bruit_ref);
+
+		debut = wtime();
+		denoise_image(&dn, &gb, image, filtree);
+		tf[nb] = wtime() - debut;
+		ef[nb] = rmse_corrigee(filtree, ref, n, bruit_ref);
+
+		denoise_tuile(&dn, &gb, image, 0, 0, w, h, une_tuile);
+		identiques = identiques && memcmp(filtree, une_tuile, 3 * n * sizeof(double)) == 0;
+	}
+
+	printf("%11s %10s %10s %10s %10s %12s %8s\n", "échantillons", "rendu", "RMSE", "filtre",
+			"RMSE filtre", "équivalent", "gain");
+	for (int k = 0; k < nb; k++) {
+		/* échantillons par pixel d'un rendu brut de même RMSE que le rendu filtré : segment
+		   de la courbe brute qui encadre ef[k] (le dernier, prolongé, au-delà) */
+		int a = 0;
+		while (a + 2 < nb && er[a + 1] > ef[k])
+			a++;
+		double pente = log(er[a + 1] / er[a]) / log(2.);
+		double equivalent = 4. * (1 << a) * pow(2, log(ef[k] / er[a]) / pente);
+		printf("%11d %9.2fs %10.5f %9.3fs %11.5f %12.0f %7.1fx\n", 4 << k, tr[k], er[k], tf[k], ef[k],
+				equivalent, equivalent / (4 << k));
+	}
+	printf("# tuiles : %s\n", identiques ? "identique au filtre sur toute l'image"
+			: "DIFFÉRENT du filtre sur toute l'image");
+
+	gbuffer_free(&gb);
+	free(ref);
+	free(image);
+	free(filtree);
+	free(une_tuile);
+	free(moitie);
+	scene_free(&sc);
+	return !identiques;
+}
@@ -0,0 +1,98 @@
+/* Banc d'essai de l'éclairage direct (--nee) : erreur quadratique moyenne
+ * (RMSE) par rapport à une image de référence, à temps de calcul égal.
+ *
+ * La référence est la moyenne de deux rendus à beaucoup d'échantillons, l'un
+ * sans, l'autre avec NEE ; l'écart entre les deux (comparé à leur bruit)
+ * vérifie que NEE ne biaise pas l'image. Ensuite, pour un nombre croissant
+ * d'échantillons, on mesure le temps et la RMSE des deux méthodes ; la RMSE
+ * de NEE est ramenée au temps de la méthode de base en supposant
+ * RMSE ~ 1 / sqrt(temps).
+ *
+ * Sur la boîte de Cornell par défaut la lumière est une très grosse sphère
+ * presque entièrement cachée par le plafond : la plupart des directions
+ * tirées dans son cône sont à l'ombre et le gain est faible. Avec une
+ * petite lumière (scenes/cornell_petite_lumiere.txt), le rebond diffus ne
+ * la trouve presque jamais et NEE fait toute la différence.
+ *
+ * usage : ./bench_nee [scène [largeur [échantillons de la référence]]]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "render.h"
+#include "scene.h"
+
+#include "commun.h"
+
+/* rend l'image (samples échantillons par sous-pixel) ; renvoie le temps de calcul */
+static double rendu(const struct scene *sc, const struct camera *cam, int samples, bool nee, double *image)
+{
+	render_nee = nee;
+	double debut = wtime();
+	for (int i = 0; i < cam->h; i++)
+		for (int j = 0; j < cam->w; j++)
+			render_pixel(sc, cam, i, j, samples, image + 3 * (i * cam->w + j));
+	return wtime() - debut;
+}
+
+/* RMSE sur les valeurs linéaires (sans correction gamma) */
+static double rmse_lineaire(const double *a, const double *b, int n)
+{
+	double s = 0;
+	for (int k = 0; k < 3 * n; k++)
+		s += (a[k] - b[k]) * (a[k] - b[k]);
+	return sqrt(s / (3 * n));
+}
+
+int main(int argc, char **argv)
+{
+	const char *fichier_scene = (argc > 1 && argv[1][0] != '\0') ? argv[1] : NULL;
+	int w = (argc > 2) ? atoi(argv[2]) : 80;
+	int h = w * 5 / 8;
+	int s_ref = (argc > 3) ? atoi(argv[3]) : 256;
+	int n = w * h;
+
+	struct scene sc;
+	scene_load(&sc, fichier_scene);
+	struct camera cam;
+	camera_init(&cam, w, h);
+
+	double *ref_base = malloc(3 * n * sizeof(double));
+	double *ref_nee = malloc(3 * n * sizeof(double));
+	double *ref = malloc(3 * n * sizeof(double));
+	double *image = malloc(3 * n * sizeof(double));
+	if (ref_base == NULL || ref_nee == NULL || ref == NULL || image == NULL) {
+		perror("Impossible d'allouer les images");
+		exit(1);
+	}
+
+	printf("# %s, %d x %d, référence à %d échantillons par sous-pixel\n",
+			fichier_scene ? fichier_scene : "Cornell", w, h, s_ref);
+	double t_base = rendu(&sc, &cam, s_ref, false, ref_base);
+	double t_nee = rendu(&sc, &cam, s_ref, true, ref_nee);
+	for (int k = 0; k < 3 * n; k++)
+		ref[k] = 0.5 * (ref_base[k] + ref_nee[k]);
+	printf("# références : %.1f s sans NEE, %.1f s avec ; écart entre elles %.5f\n",
+			t_base, t_nee, rmse_lineaire(ref_base, ref_nee, n));
+
+	printf("%11s %10s %10s %10s %10s %18s %8s\n", "échantillons", "temps", "RMSE", "temps NEE",
+			"RMSE NEE", "RMSE NEE temps égal", "gain");
+	for (int s = 1; s <= s_ref / 8; s *= 2) {
+		double tb = rendu(&sc, &cam, s, false, image);
+		double eb = rmse_lineaire(image, ref, n);
+		double tn = rendu(&sc, &cam, s, true, image);
+		double en = rmse_lineaire(image, ref, n);
+		double en_egal = en * sqrt(tn / tb);
+		/* gain en temps pour la même erreur : (RMSE / RMSE NEE à temps égal)² */
+		printf("%11d %9.2fs %10.5f %9.2fs %10.5f %18.5f %7.2fx\n", 4 * s, tb, eb, tn, en, en_egal,
+				(eb / en_egal) * (eb / en_egal));
+	}
+
+	free(ref_base);
+	free(ref_nee);
+	free(ref);
+	free(image);
+	scene_free(&sc);
+	return 0;
+}
@@ -0,0 +1,231 @@
+/* Banc d'essai de l'ordre de parcours des tuiles (--order) : lignes,
+ * Morton ou Hilbert.
+ *
+ * 1. Localité : rend une boîte de Cornell encombrée de petites sphères (la
+ *    BVH ne tient plus dans les caches) pixel après pixel, dans l'ordre du
+ *    parcours, sur un thread ; temps, et défauts de cache lus par
+ *    perf_event_open() quand le noyau les donne (« - » sinon).
+ *
+ * 2. Fragmentation des vols : simule le partage de --strategy ring (plages
+ *    de positions du parcours, le premier processus de l'anneau qui a plus de
+ *    100 pixels en donne la moitié) avec le coût de chaque pixel (rayons
+ *    lancés) sur la scène par défaut ; chaque plage reçue est un morceau. On
+ *    compte les morceaux et la part des paires de pixels voisins qui sont dans
+ *    deux morceaux différents (0 : un seul bloc compact par morceau).
+ *
+ * usage : ./bench_ordre [petites sphères [largeur]]
+ */
+#define _GNU_SOURCE
+#include <linux/perf_event.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "render.h"
+#include "scene.h"
+#include "tuiles.h"
+
+#include "commun.h"
+
+#define DON_MIN 50              /* comme --strategy ring : on donne la moitié si elle dépasse 50 pixels */
+
+static const char *noms[] = {"lines", "morton", "hilbert"};
+
+/* compteur matériel du thread courant, -1 s'il n'est pas disponible */
+static int compteur(uint32_t type, uint64_t config)
+{
+	struct perf_event_attr a;
+	memset(&a, 0, sizeof(a));
+	a.type = type;
+	a.size = sizeof(a);
+	a.config = config;
+	a.disabled = 1;
+	a.exclude_kernel = 1;
+	a.exclude_hv = 1;
+	return syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+}
+
+static long long lit(int fd)
+{
+	long long v;
+	if (fd < 0 || read(fd, &v, sizeof(v)) != sizeof(v))
+		return -1;
+	return v;
+}
+
+/* boîte de Cornell et n petites sphères diffuses à l'intérieur */
+static void scene_encombree(struct scene *sc, int n)
+{
+	struct scene base;
+	scene_load(&base, NULL);
+	struct Sphere *s = malloc((base.n + n) * sizeof(*s));
+	if (s == NULL) {
+		perror("Impossible d'allouer la scène");
+		exit(1);
+	}
+	memcpy(s, base.spheres, base.n * sizeof(*s));
+	srand48(2019);
+	for (int k = base.n; k < base.n + n; k++) {
+		memset(&s[k], 0, sizeof(s[k]));
+		s[k].radius = 0.3 + 0.7 * drand48();
+		s[k].position[0] = 5 + 90 * drand48();
+		s[k].position[1] = 2 + 75 * drand48();
+		s[k].position[2] = 10 + 90 * drand48();
+		for (int c = 0; c < 3; c++)
+			s[k].color[c] = 0.3 + 0.6 * drand48();
+		s[k].refl = DIFF;
+	}
+	setenv("BVH_CACHE", "", 1);    /* scene_compile() ne doit pas remplir le cache */
+	scene_compile(sc, s, base.n + n);
+	free(s);
+	scene_free(&base);
+}
+
+/* morceau[p] de chaque pixel après le partage de --strategy ring entre P processus */
+static int partage(const struct tuiles *tp, const int *cout, int P, int *morceau)
+{
+	int n = tp->w * tp->h;
+	long *actual = malloc(P * sizeof(long)), *end = malloc(P * sizeof(long));
+	int *piece = malloc(P * sizeof(int));
+	double *horloge = calloc(P, sizeof(double));
+	if (actual == NULL || end == NULL || piece == NULL || horloge == NULL) {
+		perror("Impossible d'allouer la simulation");
+		exit(1);
+	}
+	for (int r = 0; r < P; r++) {
+		actual[r] = (long) n / P * r;
+		end[r] = (r == P - 1) ? n : (long) n / P * (r + 1);
+		piece[r] = r;
+	}
+	int nb_morceaux = P;
+	for (;;) {
+		/* le processus le moins avancé dans le temps calcule son pixel suivant */
+		int r = -1;
+		for (int q = 0; q < P; q++)
+			if (actual[q] < end[q] && (r < 0 || horloge[q] < horloge[r]))
+				r = q;
+		if (r < 0)
+			break;
+		int i, j;
+		tuiles_pixel(tp, actual[r], &i, &j);
+		horloge[r] += cout[i * tp->w + j];
+		morceau[i * tp->w + j] = piece[r];
+		if (++actual[r] < end[r])
+			continue;
+		/* plus rien : sa demande fait le tour de l'anneau */
+		for (int k = 1; k < P; k++) {
+			int q = (r + k) % P;
+			long moitie = (end[q] - actual[q]) / 2;
+			if (moitie > DON_MIN) {
+				actual[r] = actual[q] + moitie;
+				end[r] = end[q];
+				end[q] = actual[r];
+				piece[r] = nb_morceaux++;
+				horloge[r] = fmax(horloge[r], horloge[q]);
+				break;
+			}
+		}
+	}
+	free(actual);
+	free(end);
+	free(piece);
+	free(horloge);
+	return nb_morceaux;
+}
+
+/* part des paires de pixels voisins (4-voisinage) dans deux morceaux différents */
+static double coupure(const int *morceau, int w, int h)
+{
+	long coupees = 0, paires = 0;
+	for (int i = 0; i < h; i++)
+		for (int j = 0; j < w; j++) {
+			if (j + 1 < w) {
+				coupees += morceau[i * w + j] != morceau[i * w + j + 1];
+				paires++;
+			}
+			if (i + 1 < h) {
+				coupees += morceau[i * w + j] != morceau[(i + 1) * w + j];
+				paires++;
+			}
+		}
+	return (double) coupees / paires;
+}
+
+int main(int argc, char **argv)
+{
+	int nb_spheres = (argc > 1) ? atoi(argv[1]) : 200000;
+	int w = (argc > 2) ? atoi(argv[2]) : 160;
+	int h = w * 5 / 8;
+	struct camera cam;
+	camera_init(&cam, w, h);
+
+	/* 1. localité */
+	struct scene sc;
+	scene_encombree(&sc, nb_spheres);
+	printf("# boîte de Cornell et %d petites sphères, %d x %d, 4 échantillons par pixel\n", nb_spheres, w, h);
+	printf("%8s %10s %12s %16s %16s\n", "ordre", "temps", "Mrayons/s", "défauts L1d/ray", "défauts LLC/ray");
+	int l1 = compteur(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+	int llc = compteur(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	for (int o = ORDRE_LIGNES; o <= ORDRE_HILBERT; o++) {
+		tuiles_ordre = o;
+		struct tuiles tp;
+		tuiles_init(&tp, w, h, 0);
+		long long nb_rayons = 0;
+		long long l1_0 = lit(l1), llc_0 = lit(llc);
+		ioctl(l1, PERF_EVENT_IOC_ENABLE, 0);
+		ioctl(llc, PERF_EVENT_IOC_ENABLE, 0);
+		double debut = wtime();
+		for (long p = 0; p < (long) w * h; p++) {
+			int i, j;
+			double pixel[3];
+			tuiles_pixel(&tp, p, &i, &j);
+			nb_rayons += render_pixel(&sc, &cam, i, j, 1, pixel);
+		}
+		double t = wtime() - debut;
+		ioctl(l1, PERF_EVENT_IOC_DISABLE, 0);
+		ioctl(llc, PERF_EVENT_IOC_DISABLE, 0);
+		long long dl1 = lit(l1) - l1_0, dllc = lit(llc) - llc_0;
+		char s1[32] = "-", s2[32] = "-";
+		if (l1 >= 0)
+			snprintf(s1, sizeof(s1), "%.2f", (double) dl1 / nb_rayons);
+		if (llc >= 0)
+			snprintf(s2, sizeof(s2), "%.3f", (double) dllc / nb_rayons);
+		printf("%8s %9.2fs %12.2f %16s %16s\n", noms[o], t, nb_rayons / t / 1e6, s1, s2);
+		tuiles_free(&tp);
+	}
+	scene_free(&sc);
+
+	/* 2. fragmentation : coût de chaque pixel sur la scène par défaut */
+	scene_load(&sc, NULL);
+	int *cout = malloc(w * h * sizeof(int));
+	int *morceau = malloc(w * h * sizeof(int));
+	if (cout == NULL || morceau == NULL) {
+		perror("Impossible d'allouer les coûts");
+		exit(1);
+	}
+	for (int i = 0; i < h; i++)
+		for (int j = 0; j < w; j++) {
+			double pixel[3];
+			cout[i * w + j] = render_pixel(&sc, &cam, i, j, 4, pixel);
+		}
+	printf("# partage de --strategy ring simulé (scène par défaut, %d x %d)\n", w, h);
+	printf("%10s %8s %10s %18s\n", "processus", "ordre", "morceaux", "voisins séparés");
+	for (int P = 4; P <= 64; P *= 4)
+		for (int o = ORDRE_LIGNES; o <= ORDRE_HILBERT; o++) {
+			tuiles_ordre = o;
+			struct tuiles tp;
+			tuiles_init(&tp, w, h, 0);
+			int nb = partage(&tp, cout, P, morceau);
+			printf("%10d %8s %10d %17.2f%%\n", P, noms[o], nb, 100 * coupure(morceau, w, h));
+			tuiles_free(&tp);
+		}
+	free(cout);
+	free(morceau);
+	scene_free(&sc);
+	return 0;
+}
@@ -0,0 +1,196 @@
+/* Banc d'essai du générateur aléatoire : erand48 (l'ancien générateur)
+ * contre Philox4x32-10 appelé chemin par chemin (rng_uniform4) et par
+ * lots vectorisés (rng_uniform4_n).
+ *
+ * Vérifie que les lots donnent exactement les tirages scalaires, puis
+ * fait quelques tests statistiques sur les tirages tels que le rendu les
+ * consomme (pixels voisins, échantillons et rebonds successifs) :
+ * moyenne, variance, chi² à 1 et 2 dimensions, corrélations. Chaque test
+ * est ramené à un écart normalisé z ; il échoue si |z| > 5.
+ *
+ * usage : ./bench_rng [nombre de tirages, en millions]
+ */
+#define _XOPEN_SOURCE 600
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rng.h"
+
+#include "commun.h"
+
+#define LOT 4096                /* chemins par appel à rng_uniform4_n */
+#define Z_MAX 5
+
+/* chemin numéro c d'une image de 512 colonnes, à 4 sous-pixels et 64 échantillons */
+static struct rng_path chemin(long long c)
+{
+	return rng_path_init(c >> 17, (c >> 8) & 511, (c >> 6) & 3, c & 63);
+}
+
+static int nb_echecs;
+
+static void verdict(const char *nom, double z)
+{
+	bool ok = fabs(z) <= Z_MAX;
+	printf("  %-44s z = %+7.2f  %s\n", nom, z, ok ? "ok" : "ÉCHEC");
+	if (!ok)
+		nb_echecs++;
+}
+
+/* chi² des n valeurs de x dans nb classes ; renvoie l'écart normalisé (ddl = nb - 1) */
+static double chi2_z(const long long *classes, int nb, long long n)
+{
+	double attendu = (double) n / nb, chi2 = 0;
+	for (int b = 0; b < nb; b++) {
+		double e = classes[b] - attendu;
+		chi2 += e * e / attendu;
+	}
+	return (chi2 - (nb - 1)) / sqrt(2.0 * (nb - 1));
+}
+
+/* coefficient de corrélation ramené à un écart normalisé : r * sqrt(n) */
+struct correlation {
+	double sx, sy, sxx, syy, sxy;
+	long long n;
+};
+
+static void correlation_add(struct correlation *c, double x, double y)
+{
+	c->sx += x; c->sy += y;
+	c->sxx += x * x; c->syy += y * y; c->sxy += x * y;
+	c->n++;
+}
+
+static double correlation_z(const struct correlation *c)
+{
+	double n = c->n;
+	double cov = c->sxy / n - (c->sx / n) * (c->sy / n);
+	double vx = c->sxx / n - (c->sx / n) * (c->sx / n);
+	double vy = c->syy / n - (c->sy / n) * (c->sy / n);
+	return cov / sqrt(vx * vy) * sqrt(n);
+}
+
+int main(int argc, char **argv)
+{
+	long long n = (argc > 1) ? atoll(argv[1]) << 20 : 1LL << 24;   /* nombre de doubles tirés */
+	long long nb_chemins = n / 4;
+	volatile double puits;          /* empêche le compilateur de supprimer les boucles */
+
+	/* débit */
+	printf("# débit, %lld tirages (Mtirages/s)\n", n);
+	unsigned short etat[3] = {0, 0, 12345};
+	double somme = 0;
+	double debut = wtime();
+	for (long long k = 0; k < n; k++)
+		somme += erand48(etat);
+	double t_erand = wtime() - debut;
+	puits = somme;
+
+	somme = 0;
+	debut = wtime();
+	for (long long c = 0; c < nb_chemins; c++) {
+		struct rng_path p = chemin(c);
+		double u[4];
+		rng_uniform4(&p, 1, u);
+		somme += u[0] + u[1] + u[2] + u[3];
+	}
+	double t_philox = wtime() - debut;
+	puits = somme;
+
+	static struct rng_path paths[LOT];
+	static int depths[LOT];
+	static double u_lot[LOT][4];
+	somme = 0;
+	debut = wtime();
+	for (long long c = 0; c < nb_chemins; c += LOT) {
+		int m = (nb_chemins - c < LOT) ? nb_chemins - c : LOT;
+		for (int k = 0; k < m; k++) {
+			paths[k] = chemin(c + k);
+			depths[k] = 1;
+		}
+		rng_uniform4_n(paths, depths, m, u_lot);
+		for (int k = 0; k < m; k++)
+			somme += u_lot[k][0] + u_lot[k][1] + u_lot[k][2] + u_lot[k][3];
+	}
+	double t_lot = wtime() - debut;
+	puits = somme;
+	(void) puits;
+
+	printf("  %-24s %8.1f\n", "erand48", n / t_erand / 1e6);
+	printf("  %-24s %8.1f  (%.2fx)\n", "philox rng_uniform4", n / t_philox / 1e6, t_erand / t_philox);
+	printf("  %-24s %8.1f  (%.2fx)\n", "philox rng_uniform4_n", n / t_lot / 1e6, t_erand / t_lot);
+
+	/* les lots doivent donner exactement les tirages scalaires */
+	int differences = 0;
+	srand48(1);
+	for (int k = 0; k < LOT; k++) {
+		paths[k] = rng_path_init(lrand48() % 4000, lrand48() % 4000, lrand48() % 4, lrand48());
+		paths[k].branch = lrand48() & 0x1e;
+		depths[k] = lrand48() % 64;
+	}
+	for (int m = 1; m <= LOT; m = 2 * m + 1) {
+		rng_uniform4_n(paths, depths, m, u_lot);
+		for (int k = 0; k < m; k++) {
+			double u[4];
+			rng_uniform4(&paths[k], depths[k], u);
+			for (int a = 0; a < 4; a++)
+				differences += (u[a] != u_lot[k][a]);
+		}
+	}
+	printf("# lots contre scalaire : %s\n", differences ? "DIFFÉRENTS" : "identiques");
+	if (differences)
+		nb_echecs++;
+
+	/* statistiques : tirages du rebond 1 de chaque chemin, comme dans le rendu */
+	printf("# qualité statistique, %lld chemins\n", nb_chemins);
+	static long long classes1[4][256], classes2[32 * 32];
+	double s[4] = {0}, s2[4] = {0};
+	struct correlation voisin_j = {0}, voisin_s = {0}, rebond = {0}, composantes = {0};
+	for (long long c = 0; c < nb_chemins; c++) {
+		struct rng_path p = chemin(c);
+		double u[4], v[4];
+		rng_uniform4(&p, 1, u);
+		for (int a = 0; a < 4; a++) {
+			classes1[a][(int) (u[a] * 256)]++;
+			s[a] += u[a];
+			s2[a] += u[a] * u[a];
+		}
+		classes2[(int) (u[1] * 32) * 32 + (int) (u[2] * 32)]++;   /* direction diffuse */
+		correlation_add(&composantes, u[0], u[3]);
+
+		/* même (sous-pixel, échantillon), pixel voisin : seule la clé change */
+		struct rng_path q = p;
+		q.key[1] += 4;
+		rng_uniform4(&q, 1, v);
+		correlation_add(&voisin_j, u[1], v[1]);
+		/* échantillon suivant du même sous-pixel */
+		q = p;
+		q.sample++;
+		rng_uniform4(&q, 1, v);
+		correlation_add(&voisin_s, u[1], v[1]);
+		/* rebond suivant du même chemin */
+		rng_uniform4(&p, 2, v);
+		correlation_add(&rebond, u[2], v[2]);
+	}
+	for (int a = 0; a < 4; a++) {
+		char nom[64];
+		double moyenne = s[a] / nb_chemins, variance = s2[a] / nb_chemins - moyenne * moyenne;
+		snprintf(nom, sizeof(nom), "u[%d] moyenne %.6f", a, moyenne);
+		verdict(nom, (moyenne - 0.5) / sqrt(1. / 12 / nb_chemins));
+		/* variance d'un estimateur de variance uniforme : (1/80 - 1/144) / n */
+		snprintf(nom, sizeof(nom), "u[%d] variance %.6f (1/12)", a, variance);
+		verdict(nom, (variance - 1. / 12) / sqrt((1. / 80 - 1. / 144) / nb_chemins));
+		snprintf(nom, sizeof(nom), "u[%d] chi² 256 classes", a);
+		verdict(nom, chi2_z(classes1[a], 256, nb_chemins));
+	}
+	verdict("(u[1], u[2]) chi² 32 x 32 classes", chi2_z(classes2, 32 * 32, nb_chemins));
+	verdict("corrélation u[0], u[3]", correlation_z(&composantes));
+	verdict("corrélation pixels voisins", correlation_z(&voisin_j));
+	verdict("corrélation échantillons successifs", correlation_z(&voisin_s));
+	verdict("corrélation rebonds successifs", correlation_z(&rebond));
+
+	printf("# %s\n", nb_echecs ? "ÉCHEC" : "tous les tests passent");
+	return nb_echecs ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+/* Banc d'essai des échantillonneurs (--sampler) : erreur quadratique
+ * moyenne (RMSE, après correction gamma) par rapport à une image de
+ * référence, pour philox (nombres indépendants) et sobol (suite de Sobol
+ * brouillée), au même nombre d'échantillons puis à temps égal.
+ *
+ * La colonne "sobol N/2" est la RMSE de sobol à la moitié des échantillons
+ * de la ligne, à comparer à celle de philox : sobol vaut deux fois moins
+ * d'échantillons quand elles sont égales. La dernière colonne est le nombre
+ * d'échantillons dont philox a besoin pour atteindre la RMSE de sobol,
+ * interpolé (en log-log) entre les deux mesures de philox qui l'encadrent.
+ *
+ * La référence est rendue avec philox, sur des échantillons à partir de
+ * REF_DECALAGE, indépendants de ceux des rendus mesurés.
+ *
+ * usage : ./bench_sampler [--nee] [scène [largeur [échantillons de la référence]]]
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "blas.h"
+#include "render.h"
+#include "sampler.h"
+#include "scene.h"
+
+#include "commun.h"
+
+#define MAX_MESURES 32
+
+/* rend l'image avec l'échantillonneur sp (samples échantillons par sous-pixel) ; renvoie le temps de calcul */
+static double rendu(const struct scene *sc, const struct camera *cam, const struct sampler *sp, int samples,
+		double *image)
+{
+	render_sampler = sp;
+	double debut = wtime();
+	for (int i = 0; i < cam->h; i++)
+		for (int j = 0; j < cam->w; j++)
+			render_pixel(sc, cam, i, j, samples, image + 3 * (i * cam->w + j));
+	return wtime() - debut;
+}
+
+/* échantillons de philox pour la RMSE e, interpolés en log-log entre deux mesures ;
+   -1 si e est hors des mesures */
+static double philox_equivalent(const int *ech, const double *ep, int nb, double e)
+{
+	for (int k = 0; k + 1 < nb; k++)
+		if (ep[k] >= e && e >= ep[k + 1]) {
+			double t = log(ep[k] / e) / log(ep[k] / ep[k + 1]);
+			return ech[k] * pow((double) ech[k + 1] / ech[k], t);
+		}
+	return -1;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1 && strcmp(argv[1], "--nee") == 0) {
+		render_nee = true;
+		argc--;
+		argv++;
+	}
+	const char *fichier_scene = (argc > 1 && argv[1][0] != '\0') ? argv[1] : NULL;
+	int w = (argc > 2) ? atoi(argv[2]) : 80;
+	int h = w * 5 / 8;
+	int s_ref = (argc > 3) ? atoi(argv[3]) : 256;
+	int n = w * h;
+
+	struct scene sc;
+	scene_load(&sc, fichier_scene);
+	struct camera cam;
+	camera_init(&cam, w, h);
+
+	double *ref = malloc(3 * n * sizeof(double));
+	double *image = malloc(3 * n * sizeof(double));
+	if (ref == NULL || image == NULL) {
+		perror("Impossible d'allouer les images");
+		exit(1);
+	}
+
+	printf("# %s%s, %d x %d, référence à %d échantillons par sous-pixel\n",
+			fichier_scene ? fichier_scene : "Cornell", render_nee ? " (--nee)" : "", w, h, s_ref);
+	double debut = wtime();
+	render_sampler = &sampler_philox;
+	rendu_echantillons(&sc, &cam, s_ref, REF_DECALAGE, ref);
+	printf("# référence : %.1f s\n", wtime() - debut);
+
+	int nb = 0, ech[MAX_MESURES];
+	double tp[MAX_MESURES], ep[MAX_MESURES], ts[MAX_MESURES], es[MAX_MESURES];
+	for (int s = 1; s <= s_ref / 4 && nb < MAX_MESURES; s *= 2, nb++) {
+		ech[nb] = s;
+		tp[nb] = rendu(&sc, &cam, &sampler_philox, s, image);
+		ep[nb] = rmse(image, ref, n);
+		ts[nb] = rendu(&sc, &cam, &sampler_sobol, s, image);
+		es[nb] = rmse(image, ref, n);
+	}
+
+	printf("%11s %10s %10s %10s %10s %10s %10s %16s\n", "échantillons", "temps", "RMSE", "temps sobol",
+			"RMSE sobol", "sobol N/2", "gain temps", "philox équivalent");
+	for (int k = 0; k < nb; k++) {
+		/* gain en temps pour la même erreur, en supposant RMSE ~ 1 / sqrt(temps) */
+		double gain = (ep[k] / es[k]) * (ep[k] / es[k]) * tp[k] / ts[k];
+		double equivalent = philox_equivalent(ech, ep, nb, es[k]);
+		printf("%11d %9.2fs %10.5f %10.2fs %10.5f", 4 * ech[k], tp[k], ep[k], ts[k], es[k]);
+		if (k > 0)
+			printf(" %10.5f", es[k - 1]);
+		else
+			printf(" %10s", "-");
+		if (equivalent > 0)
+			printf(" %9.2fx %16.0f\n", gain, 4 * equivalent);
+		else
+			printf(" %9.2fx %16s\n", gain, "-");
+	}
+
+	free(ref);
+	free(image);
+	scene_free(&sc);
+	return 0;
+}
@@ -0,0 +1,58 @@
+/* Outils communs aux bancs d'essai : chronomètre, images de référence et
+ * erreur quadratique moyenne. Tout est static : chaque banc est un seul
+ * fichier, lié aux objets de src/.
+ */
+#ifndef BENCH_COMMUN_H
+#define BENCH_COMMUN_H
+
+#include <math.h>
+#include <sys/time.h>
+
+#include "blas.h"
+#include "render.h"
+
+/* numéro du premier échantillon des références : indépendantes des rendus mesurés */
+#define REF_DECALAGE (1 << 24)
+
+static inline double wtime(void)
+{
+	struct timeval ts;
+	gettimeofday(&ts, NULL);
+	return (double)ts.tv_sec + ts.tv_usec / 1E6;
+}
+
+/* rend l'image avec samples échantillons par sous-pixel, numérotés à partir de
+   decalage (comme render_pixel, qui part de 0) ; ligne i depuis le bas */
+static inline void rendu_echantillons(const struct scene *sc, const struct camera *cam, int samples, int decalage,
+		double *image)
+{
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < cam->h; i++)
+		for (int j = 0; j < cam->w; j++) {
+			double *pixel = image + 3 * (i * cam->w + j);
+			zero(pixel);
+			for (int sub = 0; sub < 4; sub++) {
+				double somme[3] = {0, 0, 0};
+				for (int s = 0; s < samples; s++) {
+					double e[3];
+					render_sample(sc, cam, i, j, sub, decalage + s, e);
+					axpy(1. / samples, e, somme);
+				}
+				clamp(somme);
+				axpy(0.25, somme, pixel);
+			}
+		}
+}
+
+/* RMSE après la correction gamma de toInt() (x^(1/2.2)) : l'erreur sur l'image qu'on regarde */
+static inline double rmse(const double *a, const double *b, int n)
+{
+	double s = 0;
+	for (int k = 0; k < 3 * n; k++) {
+		double e = pow(a[k], 1 / 2.2) - pow(b[k], 1 / 2.2);
+		s += e * e;
+	}
+	return sqrt(s / (3 * n));
+}
+
+#endif
@@ -0,0 +1,53 @@
+/* Échantillonnage adaptatif : au lieu de samples échantillons par sous-pixel
+ * partout, chaque pixel garde la moyenne et la variance (Welford) de ses
+ * échantillons, et le budget restant va aux pixels dont l'erreur relative
+ * (écart type de la moyenne / moyenne) est la plus grande.
+ *
+ * Le rendu se fait par passes sur une plage de pixels [debut, fin) (numéro
+ * p = i * w + j, ligne i comptée depuis le bas). Après une première passe
+ * à n0 échantillons partout, chaque passe range les pixels dans des classes
+ * d'erreur, choisit un seuil tel que les pixels au-dessus tiennent dans la
+ * moitié du budget restant, et double leur nombre d'échantillons (si la classe
+ * la plus haute n'y tient pas, une fraction du pas, arrondie au hasard par
+ * pixel : en moyenne, tout le budget est dépensé). Avec MPI, chaque
+ * rang traite sa plage et somme les classes avec les autres (fonction
+ * somme) : tous les rangs prennent les mêmes décisions.
+ *
+ * Les échantillons d'un sous-pixel sont toujours s = 0, 1, ..., n - 1 : un
+ * pixel qui reçoit n échantillons a la même valeur quel que soit le pilote.
+ */
+#ifndef ADAPTATIF_H
+#define ADAPTATIF_H
+
+#include "render.h"
+
+#define ADAPTATIF_CLASSES 64          /* classes d'erreur : 4 par octave, de 2^-12 à 2^4 */
+
+struct adaptatif {
+	int n0;                /* échantillons par sous-pixel de la première passe */
+	int n_max;             /* au plus n_max échantillons par sous-pixel */
+	double cible;          /* erreur relative visée (0 : on dépense tout le budget) */
+	long long budget;      /* échantillons par sous-pixel, pour toute l'image */
+};
+
+struct pixel_stats {
+	double somme[4][3];    /* somme des échantillons de chaque sous-pixel */
+	double moyenne, m2;    /* luminance des échantillons du pixel (moyenne des 4 sous-pixels) */
+	int n;                 /* échantillons par sous-pixel */
+};
+
+/* n0 = samples / 4 (au moins 4), n_max = 16 * samples, budget = samples par pixel de l'image */
+void adaptatif_defaut(struct adaptatif *ad, int samples, int nb_pixels);
+
+/* somme en place de t[0 .. n - 1] sur tous les participants (NULL : un seul) */
+typedef void (*adaptatif_somme)(long long *t, int n);
+
+/* rend les pixels [debut, fin) de l'image de cam ; stats[p - debut] et
+   out[3 * (p - debut)] ; renvoie le nombre de rayons lancés */
+long long adaptatif_rendu(const struct scene *sc, const struct camera *cam, const struct adaptatif *ad,
+		int debut, int fin, struct pixel_stats *stats, double *out, adaptatif_somme somme);
+
+/* erreur relative de la moyenne du pixel (INFINITY avec moins de 2 échantillons) */
+double adaptatif_erreur(const struct pixel_stats *st);
+
+#endif
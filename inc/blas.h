@@ -0,0 +1,76 @@
+/* Opérations sur les vecteurs de R^3 utilisées par le rendu :
+ * micro BLAS LEVEL-1 + quelques fonctions non-standard.
+ */
+#ifndef BLAS_H
+#define BLAS_H
+
+#include <math.h>
+
+/********** micro BLAS LEVEL-1 + quelques fonctions non-standard **************/
+static inline void copy(const double *x, double *y)
+{
+	for (int i = 0; i < 3; i++)
+		y[i] = x[i];
+}
+
+static inline void zero(double *x)
+{
+	for (int i = 0; i < 3; i++)
+		x[i] = 0;
+}
+
+static inline void axpy(double alpha, const double *x, double *y)//a*x+y
+{
+	for (int i = 0; i < 3; i++)
+		y[i] += alpha * x[i];
+}
+
+static inline void scal(double alpha, double *x)// multiplie par un scalaire
+{
+	for (int i = 0; i < 3; i++)
+		x[i] *= alpha;
+}
+
+static inline double dot(const double *a, const double *b)//Produit scalaire
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline double nrm2(const double *a)
+{
+	return sqrt(dot(a, a));
+}
+
+/********* fonction non-standard *************/
+static inline void mul(const double *x, const double *y, double *z)
+{
+	for (int i = 0; i < 3; i++)
+		z[i] = x[i] * y[i];
+}
+
+static inline void normalize(double *x)
+{
+	scal(1 / nrm2(x), x);
+}
+
+/* produit vectoriel */
+static inline void cross(const double *a, const double *b, double *c)
+{
+	c[0] = a[1] * b[2] - a[2] * b[1];
+	c[1] = a[2] * b[0] - a[0] * b[2];
+	c[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/****** tronque *************/
+static inline void clamp(double *x)
+{
+	for (int i = 0; i < 3; i++) {
+		if (x[i] < 0)
+			x[i] = 0;
+		if (x[i] > 1)
+			x[i] = 1;
+	}
+}
+
+
+#endif
@@ -0,0 +1,63 @@
+/* Hiérarchie de volumes englobants (BVH) sur les sphères.
+ *
+ * Construite par découpage binné selon l'heuristique des surfaces (SAH).
+ * Les noeuds sont rangés en profondeur d'abord : le fils gauche d'un noeud
+ * interne est le noeud suivant, seul le fils droit est stocké. Les sphères
+ * sont recopiées dans l'ordre des feuilles, chaque feuille couvre donc une
+ * plage contiguë des tableaux px/py/pz/r2.
+ */
+#ifndef BVH_H
+#define BVH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* plus long chemin de la racine à une feuille, en noeuds : la construction s'arrête
+   à cette profondeur (la SAH ne l'atteint pas en pratique) et bvh_load refuse un
+   cache plus profond. Le parcours empile au plus un noeud par niveau interne. */
+#define BVH_PROFONDEUR_MAX 64
+#define BVH_PILE_MAX (BVH_PROFONDEUR_MAX - 1)
+
+struct bvh_node {
+	double min[3], max[3];  /* boîte englobante */
+	int first;              /* feuille : première sphère ; noeud interne : fils droit */
+	int count;              /* feuille : nombre de sphères ; 0 pour un noeud interne */
+};
+
+struct bvh {
+	int n;                  /* nombre de sphères */
+	int nb_nodes;
+	int profondeur;         /* noeuds sur le plus long chemin de la racine à une feuille */
+	struct bvh_node *nodes;
+	int *prim;              /* prim[k] : indice d'origine de la k-ième sphère (ordre des feuilles) */
+	double *px, *py, *pz;   /* centres, dans l'ordre des feuilles */
+	double *r2;             /* rayons au carré, dans l'ordre des feuilles */
+	void *bloc;             /* unique allocation contenant tout ce qui précède */
+	size_t taille;          /* taille de bloc, en octets */
+	void *mapping;          /* projection du fichier cache, NULL si bloc est alloué */
+};
+
+/* construit la BVH des n sphères de centres (px, py, pz) et de rayons radius */
+void bvh_build(struct bvh *b, const double *px, const double *py, const double *pz, const double *radius, int n);
+void bvh_free(struct bvh *b);
+
+/* Cache sur disque : le bloc est écrit tel quel derrière un en-tête, et relu
+   par mmap en lecture seule (tous les processus d'une machine partagent alors
+   les mêmes pages du cache du noyau). Le fichier est identifié par un hachage
+   des sphères. */
+uint64_t bvh_hash(const double *px, const double *py, const double *pz, const double *radius, int n);
+bool bvh_load(struct bvh *b, const char *path, uint64_t hash, int n);
+bool bvh_save(const struct bvh *b, const char *path, uint64_t hash);
+
+/* charge dir/bvh-<hachage>.bin s'il existe ; sinon construit la BVH et l'y
+   écrit. Un verrou (flock) fait qu'un seul processus construit, les autres
+   attendent puis projettent le fichier. */
+void bvh_build_cached(struct bvh *b, const char *dir, const double *px, const double *py, const double *pz,
+		const double *radius, int n);
+
+/* plus proche intersection (t > 1e-4) du rayon avec les sphères ; id est l'indice d'origine.
+   Même résultat que le parcours linéaire (à t égal, le plus petit indice). */
+bool bvh_intersect(const struct bvh *b, const double *ray_origin, const double *ray_direction, double *t, int *id);
+
+#endif
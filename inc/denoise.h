@@ -0,0 +1,58 @@
+/* Débruitage de l'image finale (--denoise), avant toInt() : filtre en
+ * ondelettes « à trous » guidé par les contours (Dammertz et al., HPG 2010).
+ *
+ * On calcule d'abord, pour chaque pixel, la normale, l'albédo et la
+ * distance du premier point diffus vu par la caméra (en traversant miroirs
+ * et verre) : ce sont les tampons de guidage, presque sans bruit. Le filtre
+ * travaille sur l'éclairement (couleur / albédo) et fait DENOISE_PASSES
+ * passes d'un noyau 5 x 5 dont les trous doublent (pas 1, 2, 4, ...) ; le
+ * poids d'un voisin baisse quand sa couleur, sa normale, son albédo ou sa
+ * distance diffèrent : le flou s'arrête aux arêtes.
+ *
+ * Le travail est découpé en tuiles indépendantes : une tuile relit une
+ * marge de DENOISE_MARGE pixels autour d'elle et donne exactement les
+ * pixels du filtre appliqué à toute l'image. denoise_image() répartit les
+ * tuiles entre les threads OpenMP ; un autre pilote peut aussi bien
+ * répartir les tuiles entre processus.
+ */
+#ifndef DENOISE_H
+#define DENOISE_H
+
+#include "render.h"
+
+#define DENOISE_PASSES 5
+#define DENOISE_MARGE (2 * ((1 << DENOISE_PASSES) - 1))   /* rayon total des 5 noyaux à trous */
+#define DENOISE_TUILE 128
+
+/* tampons de guidage, un pixel après l'autre, dans l'ordre de l'image à filtrer */
+struct gbuffer {
+	int w, h;
+	float *normale;         /* 3 par pixel */
+	float *albedo;          /* 3 par pixel (1 pour les sources de lumière) */
+	float *profondeur;      /* longueur du chemin caméra -> premier point diffus */
+};
+
+/* calcule les tampons de guidage ; si haut_en_bas, la ligne 0 est le haut de
+   l'image (ligne de caméra h - 1, ordre du fichier PPM), sinon le bas */
+void gbuffer_init(struct gbuffer *gb, const struct scene *sc, const struct camera *cam, bool haut_en_bas);
+void gbuffer_free(struct gbuffer *gb);
+
+struct denoise {
+	float sigma_couleur;    /* écart d'éclairement toléré à la première passe (divisé par 2 à chaque passe) */
+	float sigma_normale;
+	float sigma_albedo;
+	float sigma_profondeur; /* écart relatif de distance */
+};
+
+/* réglages par défaut */
+void denoise_defaut(struct denoise *dn);
+
+/* filtre les pixels [x0, x1) x [y0, y1) de image (w x h, 3 doubles par pixel,
+   même ordre que gb) et les écrit au même endroit dans out (qui n'est pas image) */
+void denoise_tuile(const struct denoise *dn, const struct gbuffer *gb, const double *image,
+		int x0, int y0, int x1, int y1, double *out);
+
+/* toute l'image, tuiles de DENOISE_TUILE pixels réparties entre les threads */
+void denoise_image(const struct denoise *dn, const struct gbuffer *gb, const double *image, double *out);
+
+#endif
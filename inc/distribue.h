@@ -0,0 +1,135 @@
+/* Stratégies de répartition du pilote MPI commun (pathtracer_distribue).
+ *
+ * Tous les pilotes MPI font la même chose : rendre chaque pixel avec
+ * render_pixel() et rassembler l'image sur le rang 0. Ils ne diffèrent que
+ * par la façon de distribuer les pixels. Ici une stratégie est une seule
+ * fonction, choisie à l'exécution (--strategy) : on compare les
+ * ordonnancements sur le même noyau, la même scène et le même travail.
+ *
+ *   static  : un bloc de positions du parcours (--order) par processus ;
+ *   rows    : le rang 0 distribue les lignes une par une (maître/ouvriers) ;
+ *   nodes   : maître/ouvriers à deux niveaux : le rang 0 distribue des paquets
+ *             de lignes à un chef par nœud, qui les sert aux processus du
+ *             nœud ; les chefs (dont le rang 0) calculent aussi ;
+ *   ring    : blocs, puis vol de la moitié d'une plage en faisant le tour de
+ *             l'anneau des processus ;
+ *   random  : blocs, puis vol de la moitié d'une plage chez une victime tirée
+ *             au hasard (ring et random : fin détectée par l'algorithme de
+ *             Dijkstra et Safra) ;
+ *   hybrid  : blocs de tuiles, threads OpenMP avec vol dans le nœud et vol
+ *             entre nœuds par un thread de communication.
+ *
+ * Chaque pixel ne dépend que de sa position : l'image est la même pour
+ * toutes les stratégies et tous les nombres de processus. Seul le rang 0 a
+ * l'image entière ; les autres gardent les pixels qu'ils ont rendus dans un
+ * relevé (plages de pixels contigus de l'image et leurs valeurs), envoyé au
+ * rang 0 à la fin : leur mémoire suit leur part du travail. Réservé aux
+ * exécutables compilés avec mpicc.
+ */
+#ifndef DISTRIBUE_H
+#define DISTRIBUE_H
+
+#include <mpi.h>
+#include <stdbool.h>
+
+#include "render.h"
+#include "tuiles.h"
+
+#define DON_MIN 50              /* on ne donne pas une moitié de plage de 50 pixels ou moins */
+
+/* pixels rendus par un processus : plages [debut, debut + nb) d'indices i * w + j
+   de l'image, et leurs valeurs à la suite, plage après plage */
+struct releve {
+	long *plages;                   /* debut, nb, debut, nb, ... */
+	long nb_plages, max_plages;
+	double *pixels;                 /* 3 doubles par pixel */
+	long nb_pixels, max_pixels;
+};
+
+/* le travail d'un processus, et son bilan */
+struct travail {
+	const struct scene *sc;
+	const struct camera *cam;
+	int samples;
+	const struct tuiles *tp;        /* parcours de l'image : position p -> pixel (tuiles_pixel) */
+	int rang, size;                 /* dans MPI_COMM_WORLD */
+	double *image;                  /* rang 0 : 3 doubles par pixel, ligne de caméra i en i * w ; NULL ailleurs */
+	struct releve releve;           /* hors du rang 0 : les pixels rendus */
+
+	/* bilan (distribue_pixel et distribue_ligne le tiennent à jour) */
+	long pixels;
+	long long rayons;
+	double calcul;                  /* secondes passées à rendre */
+	double dernier;                 /* MPI_Wtime() à la fin du dernier pixel */
+	long messages;                  /* envoyés par la stratégie (hors rassemblement de l'image) */
+};
+
+struct strategie {
+	const char *nom;
+	/* rend la part de ce processus ; au retour, l'image complète est sur le rang 0 */
+	void (*rend)(struct travail *tr);
+};
+
+/* strategie du nom donné ("static", "rows", "nodes", "ring", "random", "hybrid"), NULL si inconnue */
+const struct strategie *strategie_cherche(const char *nom);
+
+/* où écrire les pixels [indice, indice + nb) de l'image : dans tr->image sur le rang 0,
+   à la fin du relevé r ailleurs (valable jusqu'au prochain ajout à r) */
+double *distribue_place(struct travail *tr, struct releve *r, long indice, long nb);
+
+/* ajoute les plages de src à la fin de dst, et libère src */
+void releve_concatene(struct releve *dst, struct releve *src);
+void releve_free(struct releve *r);
+
+/* rend le pixel numéro p du parcours */
+void distribue_pixel(struct travail *tr, long p);
+
+/* rend les pixels [j0, j1) de la ligne de caméra i dans pixels (pixel j en 3 * (j - j0)) */
+void distribue_ligne(struct travail *tr, int i, int j0, int j1, double *pixels);
+
+/* les relevés des autres processus sont envoyés au rang 0 et recopiés dans son image */
+void distribue_rassemble(struct travail *tr);
+
+/* Fin des stratégies à vol entre processus (ring, random, hybrid) : détection de
+   terminaison de Dijkstra et Safra (distribue_vol.c). Un processus est actif tant
+   qu'il a du travail ; seuls les dons rendent actif. Les messages partent par
+   MPI_Bsend (tampon attaché par la stratégie) et sont comptés : la stratégie ajoute
+   1 à recus pour chaque message reçu, et terminaison_vide() attend les autres. */
+enum { TAG_JETON = 30, TAG_ARRET };
+
+struct terminaison {
+	struct travail *tr;
+	long compteur;                  /* dons envoyés - dons reçus */
+	bool noir;                      /* a reçu un don depuis le dernier passage du jeton */
+	bool jeton;                     /* ce processus a le jeton */
+	long jeton_somme;
+	bool jeton_noir;
+	bool tour;                      /* rang 0 : un tour du jeton est lancé */
+	bool arret;                     /* ARRET reçu (envoyé, sur le rang 0) */
+	long envoyes, recus;            /* messages, pour vider le réseau à la fin */
+};
+
+void terminaison_init(struct terminaison *f, struct travail *tr);
+
+/* envoie un message de la stratégie ; le don compte pour la terminaison */
+void terminaison_envoie(struct terminaison *f, const void *m, int nb, MPI_Datatype type, int dest, int tag);
+void terminaison_don_envoye(struct terminaison *f);
+void terminaison_don_recu(struct terminaison *f);
+
+/* processus passif : passe le jeton s'il l'a ; le rang 0 conclut (ARRET à tous) ou relance un tour */
+void terminaison_passif(struct terminaison *f);
+
+/* message reçu (2 long) : true s'il s'agissait de JETON ou d'ARRET, traités ici */
+bool terminaison_recoit(struct terminaison *f, int tag, const long *m);
+
+/* après ARRET : reçoit les messages encore en route ; sonde(ctx) traite ceux qui sont arrivés */
+void terminaison_vide(struct terminaison *f, void (*sonde)(void *ctx), void *ctx);
+
+void strategie_statique(struct travail *tr);    /* distribue.c */
+void strategie_lignes(struct travail *tr);      /* distribue_patron.c */
+void strategie_noeuds(struct travail *tr);      /* distribue_patron.c */
+void strategie_anneau(struct travail *tr);      /* distribue_vol.c */
+void strategie_hasard(struct travail *tr);      /* distribue_vol.c */
+void strategie_hybride(struct travail *tr);     /* distribue_hybride.c */
+
+#endif
@@ -0,0 +1,51 @@
+/* Placement mémoire et épinglage des threads sur les nœuds NUMA.
+ *
+ * Linux place une page sur le nœud du thread qui l'écrit le premier. Le
+ * tampon de l'image est donc réservé par mmap() sans être touché
+ * (placement_alloc) ; chaque thread de calcul met à zéro les pixels des
+ * tuiles qu'il recevra (tuiles_premier_contact), et leurs pages sont sur
+ * son nœud. Cela n'a de sens que si les threads ne changent plus de cœur :
+ * placement_epingle() les fixe (--bind compact ou spread).
+ *
+ * Les cœurs d'un processus sont ceux de son masque d'affinité si le
+ * lanceur l'a déjà restreint (mpirun --bind-to socket, par exemple), sinon
+ * sa part des cœurs du nœud, d'après son rang parmi les processus du nœud.
+ *
+ * placement_rapport() écrit ce qui a vraiment été obtenu : cœur et nœud de
+ * chaque thread, et nœud de chaque page de l'image (appel système
+ * move_pages(), en lecture seule).
+ */
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* EPINGLE_AUCUN : threads laissés au système (ou à OMP_PROC_BIND) ;
+   EPINGLE_COMPACT : thread k sur le k-ième cœur (un socket rempli avant l'autre) ;
+   EPINGLE_REPARTI : threads espacés régulièrement sur les cœurs du processus */
+enum epinglage { EPINGLE_AUCUN, EPINGLE_COMPACT, EPINGLE_REPARTI };
+extern enum epinglage placement_epinglage;      /* --bind (aucun par défaut) */
+extern bool placement_grandes_pages;            /* --huge-pages */
+
+/* "none", "compact" ou "spread" ; false si le nom est inconnu */
+bool placement_cherche(const char *nom, enum epinglage *e);
+
+/* cœurs du processus, rang_local parmi les nb_locaux processus du nœud ; le
+   rapport garde la place de nb_threads threads */
+void placement_init(int rang_local, int nb_locaux, int nb_threads);
+
+/* épingle le thread appelant, k-ième thread de calcul sur n (k < 0 : thread
+   auxiliaire, laissé sur tous les cœurs du processus) et note son cœur */
+void placement_epingle(int k, int n);
+
+/* taille octets, à zéro, non touchés ; grandes pages si placement_grandes_pages
+   (hugetlbfs si le système en a réservé, sinon pages transparentes) */
+void *placement_alloc(size_t taille);
+void placement_free(void *p, size_t taille);
+
+/* cœurs des threads et nœuds des pages de [p, p + taille), une ligne chacun */
+void placement_rapport(FILE *f, const char *qui, const void *p, size_t taille);
+
+#endif
@@ -0,0 +1,20 @@
+/* Écriture de l'image au format NetPbm (P3), commune à tous les pilotes.
+ *
+ * Le fichier va dans un répertoire au nom de l'utilisateur (créé au
+ * besoin), précédé de prefixe : "/tmp/" pour pathtracer, "" (répertoire
+ * courant) pour les pilotes MPI. Les valeurs sont corrigées (gamma 2.2)
+ * par toInt().
+ */
+#ifndef PPM_H
+#define PPM_H
+
+#include <stdbool.h>
+
+int toInt(double x);
+
+/* écrit image (3 doubles par pixel) dans prefixe<utilisateur>/nom ; retourne : image est
+   rangée ligne de caméra i (le bas d'abord) et le fichier commence par le haut ; sinon
+   image est déjà dans l'ordre du fichier */
+void ppm_ecrit(const char *prefixe, const char *nom, const double *image, int w, int h, bool retourne);
+
+#endif
@@ -0,0 +1,67 @@
+/* Rendu progressif : au lieu de moyenner et borner chaque sous-pixel tout
+ * de suite (render_pixel), on garde la somme de ses échantillons (en double)
+ * et leur nombre, et on ajoute les échantillons par passes. Après chaque
+ * passe, l'état est écrit dans un point de reprise ; un autre lancement le
+ * relit et continue là où le premier s'est arrêté.
+ *
+ * Les échantillons d'un sous-pixel sont toujours s = 0, 1, ..., n - 1, et
+ * chacun est ajouté à la somme dans cet ordre : la somme ne dépend pas de
+ * l'endroit où les passes commencent et finissent, et un rendu repris à
+ * partir de n'importe quel point de reprise a, bit pour bit, les sommes d'un
+ * seul lancement.
+ *
+ * Avec un temps limite (--time-budget), progressif_pas() choisit la taille
+ * de la passe suivante d'après le coût mesuré d'un échantillon, pour que la
+ * dernière passe finisse avant l'échéance. Avec MPI, chaque rang garde les
+ * sommes de sa plage de pixels seulement.
+ */
+#ifndef PROGRESSIF_H
+#define PROGRESSIF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "render.h"
+
+struct progressif {
+	int w, h;
+	int debut, fin;         /* pixels p = i * w + j gardés (toute l'image : 0, w * h) */
+	uint32_t n;             /* échantillons par sous-pixel déjà accumulés */
+	uint64_t hash;          /* scène et options de rendu (refuse un point de reprise d'un autre rendu) */
+	double *somme;          /* [fin - debut][4][3] : somme des échantillons de chaque sous-pixel,
+	                           ligne i comptée depuis le bas */
+};
+
+#define PROGRESSIF_MARGE 1.1    /* la passe suivante est prévue 10 % plus longue que mesuré */
+
+/* hachage des sphères de la scène et de l'estimateur (--nee) */
+uint64_t progressif_hash(const struct scene *sc);
+
+/* sommes à zéro, n = 0 */
+void progressif_init(struct progressif *pg, int w, int h, uint64_t hash);
+
+/* idem pour les pixels [debut, fin) seulement (pas de point de reprise) */
+void progressif_init_plage(struct progressif *pg, int w, int h, int debut, int fin, uint64_t hash);
+void progressif_free(struct progressif *pg);
+
+/* relit le point de reprise path dans pg (déjà initialisé) ; false s'il
+   n'existe pas ; quitte le programme s'il vient d'un autre rendu */
+bool progressif_load(struct progressif *pg, const char *path);
+
+/* écrit le point de reprise (fichier temporaire puis rename) */
+bool progressif_save(const struct progressif *pg, const char *path);
+
+/* ajoute les échantillons n .. n + nb - 1 à chaque sous-pixel ; renvoie le nombre de rayons lancés */
+long long progressif_passe(struct progressif *pg, const struct scene *sc, const struct camera *cam, int nb);
+
+/* valeur des pixels (comme render_pixel : moyenne des sous-pixels bornés),
+   ligne i comptée depuis le bas ; le pixel p va dans image[3 * (p - debut)] */
+void progressif_image(const struct progressif *pg, double *image);
+
+/* taille de la passe suivante : un quart des échantillons déjà accumulés (au
+   moins 1), au plus max ; si cout > 0 (secondes par échantillon de chaque
+   sous-pixel, mesuré sur la passe précédente), seulement ce qui tient dans
+   restant secondes avec la marge PROGRESSIF_MARGE ; 0 : plus rien ne tient */
+int progressif_pas(uint32_t n, int max, double cout, double restant);
+
+#endif
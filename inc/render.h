@@ -0,0 +1,66 @@
+/* Noyau de rendu commun à tous les pilotes (séquentiel, MPI, OpenMP) :
+ * caméra, intégrateur de chemins (radiance) et calcul d'un pixel.
+ *
+ * Les nombres aléatoires viennent de rng.h (générateur à compteur) : un
+ * pixel donne le même résultat quel que soit le pilote qui le calcule.
+ */
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdbool.h>
+
+#include "rng.h"
+#include "scene.h"
+
+#define KILL_DEPTH 7        /* au-delà, roulette russe */
+#define SPLIT_DEPTH 4       /* jusque-là, on suit à la fois le rayon réfléchi et le rayon réfracté */
+
+struct camera {
+	int w, h;
+	double position[3];
+	double direction[3];
+	double cx[3], cy[3];     /* incréments pour passer d'un pixel à l'autre */
+};
+
+/* caméra de la boîte de Cornell, pour une image w x h */
+void camera_init(struct camera *cam, int w, int h);
+
+/* rayon dans une zone de la caméra qui correspond à peu près au sous-pixel (sub_i, sub_j)
+   du pixel (i, j) ; u[0], u[1] sont deux nombres uniformes dans [0, 1) */
+void camera_ray(const struct camera *cam, int i, int j, int sub_i, int sub_j, const double *u,
+		double *ray_origin, double *ray_direction);
+
+/* --scalar : parcours scalaire des struct Sphere au lieu de scene_intersect() */
+extern bool render_scalaire;
+
+bool render_intersect(const struct scene *sc, const double *ray_origin, const double *ray_direction,
+		double *t, int *id);
+
+/* --nee : éclairage direct vers les sphères émissives à chaque rebond diffus
+   (échantillonnage du cône de la lumière + MIS avec le rebond diffus) */
+extern bool render_nee;
+
+/* --task-depth : dans une région parallèle, les rayons réfractés des séparations
+   jusqu'à cette profondeur (au plus SPLIT_DEPTH) sont suivis par des tâches OpenMP,
+   pour que les threads libres aident les pixels coûteux (0 : jamais) */
+extern int render_task_depth;
+
+/* luminance (dans out) le long du rayon qui touche la sphère id à la distance t ;
+   renvoie le nombre de rayons lancés */
+int radiance_hit(const struct scene *sc, const double *ray_origin, const double *ray_direction, double t, int id,
+		int depth, const struct rng_path *path, double *out);
+
+/* luminance (dans out) reçue le long du rayon ; renvoie le nombre de rayons lancés */
+int radiance(const struct scene *sc, const double *ray_origin, const double *ray_direction, int depth,
+		const struct rng_path *path, double *out);
+
+/* luminance (dans out) de l'échantillon s du sous-pixel sub = 2 * sub_i + sub_j
+   du pixel (i, j) ; renvoie le nombre de rayons lancés */
+int render_sample(const struct scene *sc, const struct camera *cam, int i, int j, int sub, int s, double *out);
+
+/* luminance du pixel (i, j) (ligne i comptée depuis le bas de l'image), avec
+   sur-échantillonnage 2x2 et samples échantillons par sous-pixel ; renvoie le
+   nombre de rayons lancés */
+long long render_pixel(const struct scene *sc, const struct camera *cam, int i, int j, int samples, double *out);
+
+#endif
@@ -0,0 +1,82 @@
+/* Générateur aléatoire à compteur (Philox4x32-10, Salmon et al., SC'11).
+ *
+ * Au lieu d'un état que l'on fait avancer (erand48), chaque tirage est une
+ * fonction pure de sa "position" : (pixel, sous-pixel) forment la clé,
+ * (échantillon, rebond, branche) le compteur. Le résultat ne dépend donc
+ * ni de l'ordre dans lequel on calcule les pixels, ni du découpage du
+ * travail entre processus ou threads : tous les pilotes donnent la même
+ * image, au bit près.
+ *
+ * La branche distingue les deux sous-chemins créés par une séparation
+ * réflexion/réfraction (en dessous de SPLIT_DEPTH) : le bit depth est mis
+ * à 1 du côté réfracté.
+ */
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u       /* nombre d'or */
+#define PHILOX_W1 0xBB67AE85u       /* sqrt(3) - 1 */
+
+static inline void philox4x32(const uint32_t *ctr, const uint32_t *key, uint32_t *out)
+{
+	uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+	uint32_t k0 = key[0], k1 = key[1];
+	for (int r = 0; r < 10; r++) {
+		uint64_t p0 = (uint64_t) PHILOX_M0 * c0;
+		uint64_t p1 = (uint64_t) PHILOX_M1 * c2;
+		uint32_t n0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+		uint32_t n2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+		c1 = (uint32_t) p1;
+		c3 = (uint32_t) p0;
+		c0 = n0;
+		c2 = n2;
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+/* identifiant d'un chemin : d'où viennent ses nombres aléatoires */
+struct rng_path {
+	uint32_t key[2];        /* (ligne i, colonne j << 2 | sous-pixel) */
+	uint32_t sample;        /* numéro de l'échantillon dans le sous-pixel */
+	uint32_t branch;        /* séparations réflexion/réfraction prises côté réfracté */
+};
+
+static inline struct rng_path rng_path_init(int i, int j, int sub, int sample)
+{
+	struct rng_path p = {{(uint32_t) i, ((uint32_t) j << 2) | (uint32_t) sub}, (uint32_t) sample, 0};
+	return p;
+}
+
+/* 4 nombres uniformes dans [0, 1) propres au rebond depth du chemin, dans le flux
+   numéro flux (dernier mot du compteur). Flux 0, rebond 0 : u[0], u[1] pour le
+   rayon caméra. Flux 0, rebonds suivants : u[0] pour la roulette russe, u[1], u[2]
+   pour la direction diffuse, u[3] pour le choix réflexion/réfraction. Flux 1 + l :
+   échantillonnage de la lumière numéro l (--nee). */
+static inline void rng_uniform4_flux(const struct rng_path *p, int depth, uint32_t flux, double *u)
+{
+	uint32_t ctr[4] = {p->sample, (uint32_t) depth, p->branch, flux};
+	uint32_t x[4];
+	philox4x32(ctr, p->key, x);
+	for (int k = 0; k < 4; k++)
+		u[k] = x[k] * 0x1p-32;
+}
+
+static inline void rng_uniform4(const struct rng_path *p, int depth, double *u)
+{
+	rng_uniform4_flux(p, depth, 0, u);
+}
+
+/* même chose pour n chemins d'un coup (u[k] = rng_uniform4(&path[k], depth[k])),
+   vectorisé : pour les lots de rayons (paquets, wavefront) ; voir src/rng.c */
+void rng_uniform4_n(const struct rng_path *path, const int *depth, int n, double (*u)[4]);
+
+#endif
@@ -0,0 +1,42 @@
+/* Échantillonneurs : d'où viennent les 4 nombres d'un rebond.
+ *
+ * Le noyau (render.c) et les variantes de pathtracer.c ne tirent plus
+ * directement dans rng.h : ils passent par render_sampler, choisi par
+ * --sampler. Un échantillonneur est une fonction pure de la position du
+ * tirage (chemin, rebond, flux), comme rng_uniform4_flux : les images ne
+ * dépendent toujours pas du découpage du travail.
+ *
+ * - philox : nombres indépendants (rng.h), l'échantillonneur historique ;
+ * - sobol : suite de Sobol en 4 dimensions, brouillée à la Owen (Burley,
+ *   "Practical Hash-based Owen Scrambling", JCGT 2020). Les échantillons
+ *   s = 0, 1, ... d'un même sous-pixel, à un rebond donné, sont les points
+ *   successifs d'une même suite : N = 2^k échantillons couvrent les strates
+ *   du plan (direction diffuse, position dans le pixel) bien mieux que N
+ *   tirages indépendants. Chaque (sous-pixel, rebond, branche, flux) a son
+ *   propre brouillage, tiré avec Philox.
+ */
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+
+#include "rng.h"
+
+struct sampler {
+	const char *nom;
+	/* même contrat que rng_uniform4_flux (rng.h) */
+	void (*uniform4)(const struct rng_path *p, int depth, uint32_t flux, double *u);
+	/* u[k] = uniform4(&path[k], depth[k], 0) pour k < n */
+	void (*uniform4_n)(const struct rng_path *path, const int *depth, int n, double (*u)[4]);
+};
+
+extern const struct sampler sampler_philox;
+extern const struct sampler sampler_sobol;
+
+/* --sampler : philox par défaut */
+extern const struct sampler *render_sampler;
+
+/* échantillonneur de ce nom, NULL s'il n'existe pas */
+const struct sampler *sampler_find(const char *nom);
+
+#endif
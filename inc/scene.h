@@ -0,0 +1,149 @@
+/* Description de la scène (sphères) et représentation "compilée" utilisée
+ * par le test d'intersection.
+ *
+ * Les tableaux de struct Sphere (AoS) restent la description de référence :
+ * c'est là qu'on lit l'émission, la couleur et le matériau au moment de
+ * l'ombrage. Le test d'intersection, lui, n'a besoin que du centre et du
+ * rayon² : scene_compile() les recopie dans des tableaux séparés (SoA),
+ * alignés et complétés jusqu'à un multiple de SCENE_LANES, pour pouvoir
+ * tester plusieurs sphères par instruction.
+ *
+ * Au-delà de SCENE_BVH_MIN sphères, scene_compile() construit en plus une
+ * BVH (voir bvh.h) et scene_intersect() la parcourt au lieu de tester
+ * toutes les sphères. La BVH est mise en cache dans $BVH_CACHE (par défaut
+ * /tmp/<utilisateur>) : les lancements suivants, et les autres processus MPI
+ * de la même machine, la projettent en mémoire au lieu de la reconstruire.
+ */
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum Refl_t {DIFF, SPEC, REFR};   /* types de matériaux (DIFFuse, SPECular, REFRactive) */
+
+struct Sphere {
+	double radius;
+	double position[3];
+	double emission[3];     /* couleur émise (=source de lumière) */
+	double color[3];        /* couleur de l'objet RGB (diffusion, refraction, ...) */
+	enum Refl_t refl;       /* type de reflection */
+	double max_reflexivity;
+};
+
+/* nombre de sphères testées par instruction (dépend du jeu d'instructions) */
+#if defined(__AVX512F__)
+#define SCENE_LANES 8
+#elif defined(__AVX__)
+#define SCENE_LANES 4
+#elif defined(__SSE2__)
+#define SCENE_LANES 2
+#else
+#define SCENE_LANES 1
+#endif
+
+/* tous les tableaux sont complétés jusqu'à un multiple de SCENE_PAD (>= SCENE_LANES)
+   et alignés sur 64 octets */
+#define SCENE_PAD 8
+
+/* nombre de sphères à partir duquel la BVH remplace le parcours linéaire
+   (point de croisement mesuré par bench_bvh) */
+#define SCENE_BVH_MIN 1536
+
+struct bvh;
+
+/* La scène compilée tient dans un seul bloc : un en-tête, les tableaux SoA
+   (px, py, pz, r2 ; n_padded chacun) puis les struct Sphere (matériaux).
+   Ce bloc est aussi le format binaire des fichiers de scène (projeté tel quel
+   par mmap) et ce que le rang 0 diffuse aux autres processus MPI. */
+#define SCENE_MAGIC "SCENEBIN"
+#define SCENE_VERSION 1
+#define SCENE_HEADER 64         /* les tableaux restent alignés sur 64 octets */
+
+struct scene_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t sphere_size;   /* sizeof(struct Sphere) : refuse un autre ABI */
+	int32_t n, n_padded;
+	uint64_t taille;        /* taille totale du bloc, en-tête compris */
+};
+
+struct scene {
+	int n;                  /* nombre de sphères */
+	int n_padded;           /* n arrondi au multiple de SCENE_PAD supérieur */
+	double *px, *py, *pz;   /* centres */
+	double *r2;             /* rayons au carré (-inf pour les sphères de bourrage) */
+	struct Sphere *spheres; /* matériaux (max_reflexivity déjà calculé) */
+	void *bloc;             /* unique bloc contenant en-tête et tableaux */
+	size_t taille;          /* taille de bloc, en octets */
+	void *mapping;          /* non NULL si bloc est un fichier projeté par mmap */
+	struct bvh *bvh;        /* NULL pour les petites scènes */
+	int nb_lumieres;        /* sphères émissives (échantillonnées par --nee) */
+	int *lumieres;
+};
+
+/* construit la scène compilée à partir de spheres[0..n-1] (calcule max_reflexivity) */
+void scene_compile(struct scene *sc, const struct Sphere *spheres, int n);
+void scene_free(struct scene *sc);
+
+/* bloc aligné pour recevoir une scène compilée */
+void *scene_alloc(size_t taille);
+
+/* adopte un bloc déjà rempli (fichier projeté ou reçu par MPI) : vérifie
+   l'en-tête, place les pointeurs et construit la BVH si besoin */
+bool scene_attach(struct scene *sc, void *bloc, size_t taille, void *mapping);
+
+/* Fichiers de scène (scene_file.c). Format texte, une sphère par ligne :
+ *     rayon  px py pz  ex ey ez  r g b  DIFF|SPEC|REFR
+ * ('#' commence un commentaire) ; ou format binaire (le bloc ci-dessus),
+ * reconnu à son en-tête. path == NULL charge la scène par défaut (Cornell).
+ * Quitte le programme en cas d'erreur. */
+void scene_load(struct scene *sc, const char *path);
+
+/* écrit la scène au format binaire */
+bool scene_save(const struct scene *sc, const char *path);
+
+/* la scène historique, compilée dans les exécutables */
+extern const struct Sphere scene_cornell[];
+extern const int scene_cornell_n;
+
+/* nom du jeu d'instructions utilisé par scene_intersect() */
+const char *scene_simd_name(void);
+
+/* distance à la sphère le long du rayon, 0 si pas d'intersection */
+double sphere_intersect(const struct Sphere *s, const double *ray_origin, const double *ray_direction);
+
+/* version scalaire historique : parcours linéaire des struct Sphere */
+bool scene_intersect_scalar(const struct Sphere *spheres, int n, const double *ray_origin,
+		const double *ray_direction, double *t, int *id);
+
+/* version vectorielle : SCENE_LANES sphères par itération, réduction du min (t, id) à la fin.
+   Donne le même (t, id) que scene_intersect_scalar() (à l'arrondi près). */
+bool scene_intersect_linear(const struct scene *sc, const double *ray_origin, const double *ray_direction,
+		double *t, int *id);
+
+/* parcours de la BVH si la scène en a une, scene_intersect_linear() sinon */
+bool scene_intersect(const struct scene *sc, const double *ray_origin, const double *ray_direction,
+		double *t, int *id);
+
+/* paquet de rayons (SoA) tracés ensemble : la vectorisation porte alors sur
+   les rayons (un rayon par voie) et non plus sur les sphères */
+#define PACKET_MAX 16
+
+struct ray_packet {
+	int n;                                    /* nombre de rayons (<= PACKET_MAX) */
+	double ox[PACKET_MAX], oy[PACKET_MAX], oz[PACKET_MAX];   /* origines */
+	double dx[PACKET_MAX], dy[PACKET_MAX], dz[PACKET_MAX];   /* directions */
+	double t[PACKET_MAX];                     /* résultat : distance (1e20 si pas d'intersection) */
+	int id[PACKET_MAX];                       /* résultat : sphère touchée (-1 sinon) */
+};
+
+/* intersecte les p->n rayons du paquet avec toutes les sphères ; remplit p->t et p->id */
+void scene_intersect_packet(const struct scene *sc, struct ray_packet *p);
+
+/* même chose pour n rayons rangés dans des tableaux séparés (SoA) de taille quelconque */
+void scene_intersect_stream(const struct scene *sc, int n, const double *ox, const double *oy, const double *oz,
+		const double *dx, const double *dy, const double *dz, double *restrict t, int *restrict id);
+
+#endif
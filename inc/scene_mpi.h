@@ -0,0 +1,36 @@
+/* Diffusion de la scène compilée aux processus MPI.
+ *
+ * Seul le rang root lit le fichier de scène ; les autres reçoivent le bloc
+ * tel quel (il contient déjà la disposition SoA et les matériaux) et se
+ * contentent de placer leurs pointeurs. Réservé aux exécutables compilés
+ * avec mpicc.
+ */
+#ifndef SCENE_MPI_H
+#define SCENE_MPI_H
+
+#include <mpi.h>
+
+#include "scene.h"
+
+/* sur root, sc est déjà chargée ; ailleurs elle est remplie par la diffusion */
+static inline void scene_bcast(struct scene *sc, int root, MPI_Comm comm)
+{
+	int rang;
+	MPI_Comm_rank(comm, &rang);
+	unsigned long long taille = (rang == root) ? sc->taille : 0;
+	MPI_Bcast(&taille, 1, MPI_UNSIGNED_LONG_LONG, root, comm);
+
+	/* le bloc est un multiple de 64 octets : un élément de 64 octets évite la limite de 2 Go d'un int */
+	MPI_Datatype ligne;
+	MPI_Type_contiguous(64, MPI_BYTE, &ligne);
+	MPI_Type_commit(&ligne);
+	void *bloc = (rang == root) ? sc->bloc : scene_alloc(taille);
+	MPI_Bcast(bloc, taille / 64, ligne, root, comm);
+	MPI_Type_free(&ligne);
+	if (rang != root && !scene_attach(sc, bloc, taille, NULL)) {
+		fprintf(stderr, "rang %d : scène reçue invalide\n", rang);
+		MPI_Abort(comm, 1);
+	}
+}
+
+#endif
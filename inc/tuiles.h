@@ -0,0 +1,110 @@
+/* Réserve de tuiles pour les threads d'un nœud, avec vol de travail.
+ *
+ * L'image est découpée en tuiles carrées de TUILE_TAILLE pixels. Chaque
+ * thread de calcul a une file à deux bouts (deque de Chase et Lev, SPAA'05,
+ * avec les barrières mémoire C11 de Lê et al., PPoPP'13) : il prend ses
+ * tuiles en bas, sans verrou ; un thread qui n'a plus rien vole une tuile en
+ * haut de la file d'un autre, choisi au hasard.
+ *
+ * Les demandes de travail d'autres processus MPI sont servies par vol dans
+ * les mêmes files (tuiles_vole_moitie) ; les tuiles reçues d'un autre
+ * processus sont poussées dans la file du thread de communication, où les
+ * threads de calcul viennent les voler : équilibrage dans le nœud et entre
+ * nœuds passent par la même structure.
+ *
+ * Les tuiles sont parcourues le long d'une courbe de Hilbert (ou de Morton) :
+ * des positions voisines sur la courbe sont des tuiles voisines dans
+ * l'image, donc une plage de positions (celle d'un thread, d'un processus,
+ * ou la moitié volée d'une plage) est une région compacte, et les tuiles
+ * traitées en même temps touchent les mêmes parties de la scène. Avec
+ * l'ordre des lignes, une tuile est une ligne de l'image (ancien parcours).
+ */
+#ifndef TUILES_H
+#define TUILES_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#define TUILE_TAILLE 16
+
+enum tuiles_ordre { ORDRE_LIGNES, ORDRE_MORTON, ORDRE_HILBERT };
+extern enum tuiles_ordre tuiles_ordre;          /* --order, pour les tuiles_init() suivants (Hilbert par défaut) */
+
+/* "lines", "morton" ou "hilbert" ; false si le nom est inconnu */
+bool tuiles_ordre_cherche(const char *nom, enum tuiles_ordre *ordre);
+
+enum { DEQUE_OK, DEQUE_VIDE, DEQUE_PERDU };     /* résultat d'un vol (PERDU : un autre l'a eu, réessayer) */
+
+/* file circulaire de numéros de tuiles ; bas n'est écrit que par le propriétaire */
+struct deque {
+	_Atomic long haut, bas;
+	_Atomic int *t;
+	long capacite;          /* au moins le nombre de tuiles : jamais plein */
+};
+
+void deque_init(struct deque *d, long capacite);
+void deque_free(struct deque *d);
+void deque_push(struct deque *d, int x);        /* propriétaire seulement */
+bool deque_pop(struct deque *d, int *x);        /* propriétaire seulement */
+int deque_vole(struct deque *d, int *x);        /* n'importe quel thread */
+
+/* nombre d'éléments (approché si d'autres threads travaillent sur la file) */
+static inline long deque_taille(struct deque *d)
+{
+	long n = atomic_load_explicit(&d->bas, memory_order_relaxed) - atomic_load_explicit(&d->haut, memory_order_relaxed);
+	return (n > 0) ? n : 0;
+}
+
+struct tuiles {
+	int w, h;
+	int tw, th;             /* taille d'une tuile (w x 1 avec l'ordre des lignes) */
+	int nx, ny, nb;         /* nx * ny = nb tuiles, numérotées ligne par ligne depuis le bas */
+	int *ordre;             /* ordre[k] : tuile en position k sur la courbe */
+	long *premier;          /* premier[k] : pixels des positions 0 .. k - 1 (nb + 1 valeurs) */
+	int nb_deques;
+	struct deque *deques;
+};
+
+/* tuiles dans l'ordre tuiles_ordre ; nb_deques files vides, de capacité nb */
+void tuiles_init(struct tuiles *tp, int w, int h, int nb_deques);
+void tuiles_free(struct tuiles *tp);
+
+/* pixels [x0, x1) x [y0, y1) de la tuile (y : ligne de caméra, comptée depuis le bas) */
+void tuiles_pixels(const struct tuiles *tp, int tuile, int *x0, int *y0, int *x1, int *y1);
+
+/* pixel (i, j) numéro p du parcours : tuiles dans l'ordre de la courbe, pixels
+   ligne par ligne dans une tuile ; p = 0 .. w * h - 1 */
+void tuiles_pixel(const struct tuiles *tp, long p, int *i, int *j);
+
+/* répartit les positions [debut, fin) de la courbe en blocs contigus entre les
+   files 0 .. n - 1 ; avant que les threads ne démarrent (chaque file est poussée
+   par ce thread) */
+void tuiles_repartit(struct tuiles *tp, int debut, int fin, int n);
+
+/* met à zéro les pixels des tuiles de la file k de tuiles_repartit(tp, debut,
+   fin, n) dans image (3 doubles par pixel ; la ligne de caméra i est en
+   h - 1 - i si haut_en_bas) : appelé par le propriétaire de la file, il place
+   ces pages sur son nœud NUMA (première écriture, voir placement.h) */
+void tuiles_premier_contact(const struct tuiles *tp, int debut, int fin, int n, int k,
+		double *image, bool haut_en_bas);
+
+/* xorshift32 : choix des victimes, dans un nœud (tuiles_prend) comme entre processus */
+static inline unsigned tuiles_alea(unsigned *graine)
+{
+	unsigned x = *graine;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *graine = x;
+}
+
+/* une tuile pour le thread propriétaire de la file moi (-1 : aucune) : la
+   sienne d'abord, sinon volée dans une autre file, en commençant par une file
+   tirée au hasard ; false si toutes les files sont vides */
+bool tuiles_prend(struct tuiles *tp, int moi, unsigned *graine, int *tuile);
+
+/* vole la moitié des tuiles qui restent dans les files (au plus max), pour un
+   autre processus ; renvoie leur nombre (0 s'il en reste moins de 2) */
+int tuiles_vole_moitie(struct tuiles *tp, unsigned *graine, int *tuiles, int max);
+
+#endif
@@ -13,160 +13,43 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <sys/time.h>
-#include <sys/stat.h>  /* pour mkdir    */ 
-#include <unistd.h>    /* pour getuid   */
-#include <sys/types.h> /* pour getpwuid */
-#include <pwd.h>       /* pour getpwuid */
-
-
-enum Refl_t {DIFF, SPEC, REFR};   /* types de matériaux (DIFFuse, SPECular, REFRactive) */
-
-struct Sphere { 
-	double radius; 
-	double position[3];
-	double emission[3];     /* couleur émise (=source de lumière) */
-	double color[3];        /* couleur de l'objet RGB (diffusion, refraction, ...) */
-	enum Refl_t refl;       /* type de reflection */
-	double max_reflexivity;
-};
-
-static const int KILL_DEPTH = 7;
-static const int SPLIT_DEPTH = 4;
+#include <unistd.h>
+#include <string.h>    /* pour strcmp   */
+#include <omp.h>
+
+#include "adaptatif.h"
+#include "blas.h"
+#include "denoise.h"
+#include "placement.h"
+#include "ppm.h"
+#include "progressif.h"
+#include "render.h"
+#include "sampler.h"
+#include "rng.h"
+#include "scene.h"
+#include "tuiles.h"
 
 /* la scène est composée uniquement de spheres */
-struct Sphere spheres[] = { 
-// radius position,                         emission,     color,              material 
-   {1e5,  { 1e5+1,  40.8,       81.6},      {},           {.75,  .25,  .25},  DIFF, -1}, // Left 
-   {1e5,  {-1e5+99, 40.8,       81.6},      {},           {.25,  .25,  .75},  DIFF, -1}, // Right 
-   {1e5,  {50,      40.8,       1e5},       {},           {.75,  .75,  .75},  DIFF, -1}, // Back 
-   {1e5,  {50,      40.8,      -1e5 + 170}, {},           {},                 DIFF, -1}, // Front 
-   {1e5,  {50,      1e5,        81.6},      {},           {0.75, .75,  .75},  DIFF, -1}, // Bottom 
-   {1e5,  {50,     -1e5 + 81.6, 81.6},      {},           {0.75, .75,  .75},  DIFF, -1}, // Top 
-   {16.5, {40,      16.5,       47},        {},           {.999, .999, .999}, SPEC, -1}, // Mirror 
-   {16.5, {73,      46.5,       88},        {},           {.999, .999, .999}, REFR, -1}, // Glass 
-   {10,   {15,      45,         112},       {},           {.999, .999, .999}, DIFF, -1}, // white ball
-   {15,   {16,      16,         130},       {},           {.999, .999, 0},    REFR, -1}, // big yellow glass
-   {7.5,  {40,      8,          120},        {},           {.999, .999, 0   }, REFR, -1}, // small yellow glass middle
-   {8.5,  {60,      9,          110},        {},           {.999, .999, 0   }, REFR, -1}, // small yellow glass right
-   {10,   {80,      12,         92},        {},           {0, .999, 0},       DIFF, -1}, // green ball
-   {600,  {50,      681.33,     81.6},      {12, 12, 12}, {},                 DIFF, -1},  // Light 
-   {5,    {50,      75,         81.6},      {},           {0, .682, .999}, DIFF, -1}, // occlusion, mirror
-}; 
-
-
-/********** micro BLAS LEVEL-1 + quelques fonctions non-standard **************/
-static inline void copy(const double *x, double *y)
-{
-	for (int i = 0; i < 3; i++)
-		y[i] = x[i];
-} 
-
-static inline void zero(double *x)
-{
-	for (int i = 0; i < 3; i++)
-		x[i] = 0;
-} 
-
-static inline void axpy(double alpha, const double *x, double *y)//a*x+y
-{
-	for (int i = 0; i < 3; i++)
-		y[i] += alpha * x[i];
-} 
-
-static inline void scal(double alpha, double *x)// multiplie par un scalaire
-{
-	for (int i = 0; i < 3; i++)
-		x[i] *= alpha;
-} 
-
-static inline double dot(const double *a, const double *b)//Produit scalaire
-{ 
-	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
-} 
-
-static inline double nrm2(const double *a)
-{
-	return sqrt(dot(a, a));
-}
+const struct Sphere *spheres;      /* matériaux de la scène chargée (scene_compilee.spheres) */ 
 
-/********* fonction non-standard *************/
-static inline void mul(const double *x, const double *y, double *z)
-{
-	for (int i = 0; i < 3; i++)
-		z[i] = x[i] * y[i];
-} 
-
-static inline void normalize(double *x)
-{
-	scal(1 / nrm2(x), x);
-}
-
-/* produit vectoriel */
-static inline void cross(const double *a, const double *b, double *c)
-{
-	c[0] = a[1] * b[2] - a[2] * b[1];
-	c[1] = a[2] * b[0] - a[0] * b[2];
-	c[2] = a[0] * b[1] - a[1] * b[0];
-}
-
-/****** tronque *************/
-static inline void clamp(double *x) 
-{
-	for (int i = 0; i < 3; i++) {
-		if (x[i] < 0)
-			x[i] = 0;
-		if (x[i] > 1)
-			x[i] = 1;
-	}
-} 
 
 /******************************* calcul des intersections rayon / sphere *************************************/
-   
-// returns distance, 0 if nohit 
-double sphere_intersect(const struct Sphere *s, const double *ray_origin, const double *ray_direction)
-{ 
-	double op[3];
-	// Solve t^2*d.d + 2*t*(o-p).d + (o-p).(o-p)-R^2 = 0 
-	copy(s->position, op);
-	axpy(-1, ray_origin, op);
-	double eps = 1e-4;
-	double b = dot(op, ray_direction);
-	double discriminant = b * b - dot(op, op) + s->radius * s->radius; 
-	if (discriminant < 0)
-		return 0;   /* pas d'intersection */
-	else 
-		discriminant = sqrt(discriminant);
-	/* détermine la plus petite solution positive (i.e. point d'intersection le plus proche, mais devant nous) */
-	double t = b - discriminant;
-	if (t > eps) {
-		return t;
-	} else {
-		t = b + discriminant;
-		if (t > eps)
-			return t;
-		else
-			return 0;  /* cas bizarre, racine double, etc. */
-	}
-}
+
+struct scene scene_compilee;        /* positions et rayons² des sphères, en SoA (voir scene.h) */
+static long long nb_rayons;         /* nombre de rayons lancés (pour les Mrayons/s), par thread */
+#pragma omp threadprivate(nb_rayons)
+static bool radiance_recursive_mode;  /* --recursive : ancienne version récursive de radiance() */
 
 /* détermine si le rayon intersecte l'une des spere; si oui renvoie true et fixe t, id */
 bool intersect(const double *ray_origin, const double *ray_direction, double *t, int *id)
 { 
-	int n = sizeof(spheres) / sizeof(struct Sphere);
-	double inf = 1e20; 
-	*t = inf;
-	for (int i = 0; i < n; i++) {
-		double d = sphere_intersect(&spheres[i], ray_origin, ray_direction);
-		if ((d > 0) && (d < *t)) {
-			*t = d;
-			*id = i;
-		} 
-	}
-	return *t < inf;
+	nb_rayons++;
+	return render_intersect(&scene_compilee, ray_origin, ray_direction, t, id);
 } 
 
-/* calcule (dans out) la lumiance reçue par la camera sur le rayon donné */
-void radiance(const double *ray_origin, const double *ray_direction, int depth, unsigned short *PRNG_state, double *out)
+/* version récursive d'origine : un appel par rebond, deux appels pour les surfaces
+   REFR en dessous de SPLIT_DEPTH. Conservée comme référence (--recursive). */
+void radiance_recursive(const double *ray_origin, const double *ray_direction, int depth, const struct rng_path *path, double *out)
 { 
 	int id = 0;                             // id de la sphère intersectée par le rayon
 	double t;                               // distance à l'intersection
@@ -203,8 +86,10 @@ void radiance(const double *ray_origin, const double *ray_direction, int depth,
 	   décide aléatoirement d'arrêter la récusion. Plus l'objet est
 	   clair, plus le processus a de chance de continuer. */
 	depth++;
+	double rnd[4];
+	render_sampler->uniform4(path, depth, 0, rnd);
 	if (depth > KILL_DEPTH) {
-		if (erand48(PRNG_state) < p) {
+		if (rnd[0] < p) {
 			scal(1 / p, f); 
 		} else {
 			copy(obj->emission, out);
@@ -218,8 +103,8 @@ void radiance(const double *ray_origin, const double *ray_direction, int depth,
 	   aléatoire dans un certain cone, et on récupère la luminance en 
 	   provenance de cette direction. */
 	if (obj->refl == DIFF) {
-		double r1 = 2 * M_PI * erand48(PRNG_state);  /* angle aléatoire */
-		double r2 = erand48(PRNG_state);             /* distance au centre aléatoire */
+		double r1 = 2 * M_PI * rnd[1];  /* angle aléatoire */
+		double r2 = rnd[2];             /* distance au centre aléatoire */
 		double r2s = sqrt(r2); 
 		
 		double w[3];   /* vecteur normal */
@@ -246,7 +131,7 @@ void radiance(const double *ray_origin, const double *ray_direction, int depth,
 		
 		/* calcule récursivement la luminance du rayon incident */
 		double rec[3];
-		radiance(x, d, depth, PRNG_state, rec);
+		radiance_recursive(x, d, depth, path, rec);
 		
 		/* pondère par la couleur de la sphère, prend en compte l'emissivité */
 		mul(f, rec, out);
@@ -265,7 +150,7 @@ void radiance(const double *ray_origin, const double *ray_direction, int depth,
 	if (obj->refl == SPEC) { 
 		double rec[3];
 		/* calcule récursivement la luminance du rayon réflechi */
-		radiance(x, reflected_dir, depth, PRNG_state, rec);
+		radiance_recursive(x, reflected_dir, depth, path, rec);
 		/* pondère par la couleur de la sphère, prend en compte l'emissivité */
 		mul(f, rec, out);
 		axpy(1, obj->emission, out);
@@ -285,7 +170,7 @@ void radiance(const double *ray_origin, const double *ray_direction, int depth,
 	if (cos2t < 0) {
 		double rec[3];
 		/* calcule seulement le rayon réfléchi */
-		radiance(x, reflected_dir, depth, PRNG_state, rec);
+		radiance_recursive(x, reflected_dir, depth, path, rec);
 		mul(f, rec, out);
 		axpy(1, obj->emission, out);
 		return;
@@ -311,19 +196,29 @@ void radiance(const double *ray_origin, const double *ray_direction, int depth,
 	double rec[3];
 	if (depth > SPLIT_DEPTH) {
 		double P = .25 + .5 * Re;             /* probabilité de réflection */
-		if (erand48(PRNG_state) < P) {
-			radiance(x, reflected_dir, depth, PRNG_state, rec);
+		if (rnd[3] < P) {
+			radiance_recursive(x, reflected_dir, depth, path, rec);
 			double RP = Re / P;
 			scal(RP, rec);
 		} else {
-			radiance(x, tdir, depth, PRNG_state, rec);
+			radiance_recursive(x, tdir, depth, path, rec);
 			double TP = Tr / (1 - P); 
 			scal(TP, rec);
 		}
 	} else {
 		double rec_re[3], rec_tr[3];
-		radiance(x, reflected_dir, depth, PRNG_state, rec_re);
-		radiance(x, tdir, depth, PRNG_state, rec_tr);
+		struct rng_path refracte = *path;    /* la branche réfractée a ses propres tirages */
+		refracte.branch |= 1u << depth;
+		if (depth <= render_task_depth) {
+			/* --task-depth : branche réfractée dans une tâche (résultat identique) */
+			#pragma omp task shared(rec_tr)
+			radiance_recursive(x, tdir, depth, &refracte, rec_tr);
+			radiance_recursive(x, reflected_dir, depth, path, rec_re);
+			#pragma omp taskwait
+		} else {
+			radiance_recursive(x, reflected_dir, depth, path, rec_re);
+			radiance_recursive(x, tdir, depth, &refracte, rec_tr);
+		}
 		zero(rec);
 		axpy(Re, rec_re, rec);
 		axpy(Tr, rec_tr, rec);
@@ -334,6 +229,464 @@ void radiance(const double *ray_origin, const double *ray_direction, int depth,
 	return;
 }
 
+/******************************* paquets de rayons *************************************/
+
+static int taille_paquet;           /* --packet N : rayons caméra tracés ensemble (0 = un par un) */
+
+static inline void packet_set(struct ray_packet *p, int k, const double *origin, const double *direction)
+{
+	p->ox[k] = origin[0];
+	p->oy[k] = origin[1];
+	p->oz[k] = origin[2];
+	p->dx[k] = direction[0];
+	p->dy[k] = direction[1];
+	p->dz[k] = direction[2];
+}
+
+/* calcule (dans out[k]) la luminance des p->n rayons du paquet.
+   Le paquet reste groupé tant que tous ses rayons touchent la même sphère SPEC,
+   ou la même sphère REFR en dessous de SPLIT_DEPTH (réflexion et réfraction
+   gardent des rayons cohérents). Dès qu'ils divergent (sphères différentes,
+   DIFF, roulette russe, réflexion totale, choix aléatoire d'une branche),
+   chaque rayon est terminé séparément par radiance_hit().
+   Les voies cohérentes ne tirent aucun nombre aléatoire : le résultat est le même
+   que rayon par rayon. path[k] identifie le chemin du rayon k. */
+void radiance_packet(struct ray_packet *p, int depth, const struct rng_path *path, double (*out)[3])
+{
+	const int m = p->n;
+	scene_intersect_packet(&scene_compilee, p);
+	nb_rayons += m;
+
+	int id = p->id[0];
+	bool coherent = (id >= 0) && (depth + 1 <= KILL_DEPTH) && (spheres[id].refl != DIFF);
+	if (coherent && spheres[id].refl == REFR)
+		coherent = (depth + 1 <= SPLIT_DEPTH);
+	for (int k = 1; k < m; k++)
+		coherent = coherent && (p->id[k] == id);
+
+	/* géométrie au point d'intersection, un rayon par voie */
+	const struct Sphere *obj = &spheres[coherent ? id : 0];
+	struct ray_packet reflechi, refracte;
+	double Re[PACKET_MAX], Tr[PACKET_MAX];
+	double nc = 1;                   /* indice de réfraction de l'air */
+	double nt = 1.5;                 /* indice de réfraction du verre */
+	double R0 = (nt - nc) * (nt - nc) / ((nt + nc) * (nt + nc));
+	reflechi.n = refracte.n = m;
+	for (int k = 0; k < m && coherent; k++) {
+		double d[3] = {p->dx[k], p->dy[k], p->dz[k]};
+		double x[3] = {p->ox[k], p->oy[k], p->oz[k]};
+		axpy(p->t[k], d, x);
+		double n[3];
+		copy(x, n);
+		axpy(-1, obj->position, n);
+		normalize(n);
+		double dn = dot(n, d);
+		double reflected_dir[3];
+		copy(d, reflected_dir);
+		axpy(-2 * dn, n, reflected_dir);
+		packet_set(&reflechi, k, x, reflected_dir);
+		if (obj->refl == SPEC)
+			continue;
+		bool into = dn <= 0;             /* vient-il de l'extérieur ? */
+		double nnt = into ? (nc / nt) : (nt / nc);
+		double ddn = into ? dn : -dn;
+		double cos2t = 1 - nnt * nnt * (1 - ddn * ddn);
+		if (cos2t < 0) {                 /* réflexion totale : ce rayon-là ne se divise pas */
+			coherent = false;
+			break;
+		}
+		double tdir[3];
+		zero(tdir);
+		axpy(nnt, d, tdir);
+		axpy(-(into ? 1 : -1) * (ddn * nnt + sqrt(cos2t)), n, tdir);
+		packet_set(&refracte, k, x, tdir);
+		double c = 1 - (into ? -ddn : dot(tdir, n));
+		Re[k] = R0 + (1 - R0) * c * c * c * c * c;
+		Tr[k] = 1 - Re[k];
+	}
+
+	if (!coherent) {
+		for (int k = 0; k < m; k++) {
+			if (p->id[k] < 0) {
+				zero(out[k]);    // if miss, return black
+				continue;
+			}
+			double o[3] = {p->ox[k], p->oy[k], p->oz[k]};
+			double d[3] = {p->dx[k], p->dy[k], p->dz[k]};
+			nb_rayons += radiance_hit(&scene_compilee, o, d, p->t[k], p->id[k], depth, &path[k], out[k]);
+		}
+		return;
+	}
+
+	depth++;
+	double rec[PACKET_MAX][3];
+	radiance_packet(&reflechi, depth, path, rec);
+	if (obj->refl == REFR) {
+		double rec_tr[PACKET_MAX][3];
+		struct rng_path path_tr[PACKET_MAX];     /* la branche réfractée a ses propres tirages */
+		for (int k = 0; k < m; k++) {
+			path_tr[k] = path[k];
+			path_tr[k].branch |= 1u << depth;
+		}
+		radiance_packet(&refracte, depth, path_tr, rec_tr);
+		for (int k = 0; k < m; k++) {
+			scal(Re[k], rec[k]);
+			axpy(Tr[k], rec_tr[k], rec[k]);
+		}
+	}
+	/* pondère par la couleur de la sphère, prend en compte l'emissivité */
+	for (int k = 0; k < m; k++) {
+		mul(obj->color, rec[k], out[k]);
+		axpy(1, obj->emission, out[k]);
+	}
+}
+
+/******************************* moteur "wavefront" *************************************/
+
+/* Alternative à radiance() (--wavefront) : au lieu de suivre un chemin de bout en
+   bout, on garde un grand lot de chemins vivants dans des tableaux séparés (SoA)
+   et on fait avancer tout le lot d'un rebond à la fois, étape par étape :
+	1. intersection de tous les rayons ;
+	2. terminaison : émission, roulette russe, rayons perdus, puis tri des
+	   chemins survivants dans une file par matériau ;
+	3. une boucle serrée par file (DIFF, SPEC, REFR) qui écrit les rayons du
+	   rebond suivant dans un second lot.
+   Chaque chemin porte son poids (throughput), sa profondeur, le sous-pixel
+   auquel il contribue et son identifiant de chemin (rng_path) : les tirages
+   aléatoires sont les mêmes que ceux de radiance(). */
+
+#define WAVEFRONT_BATCH (1 << 13)   /* nombre maximal de rayons caméra par lot */
+
+static bool wavefront;              /* --wavefront */
+
+struct path_buffer {
+	int n, capacity;
+	double *ox, *oy, *oz;           /* origine */
+	double *dx, *dy, *dz;           /* direction */
+	double *tr, *tg, *tb;           /* poids (throughput) RGB */
+	double *t;                      /* distance à l'intersection */
+	int *id;                        /* sphère touchée (-1 : aucune) */
+	int *depth;
+	int *slot;                      /* sous-pixel (dans la ligne) auquel le chemin contribue */
+	struct rng_path *path;          /* origine des tirages aléatoires du chemin */
+	double (*u)[4];                 /* tirages du rebond en cours (render_sampler->uniform4_n) */
+};
+
+static void *realloc_or_die(void *ptr, size_t size)
+{
+	ptr = realloc(ptr, size);
+	if (ptr == NULL) {
+		perror("Impossible d'allouer le lot de chemins");
+		exit(1);
+	}
+	return ptr;
+}
+
+static void path_buffer_reserve(struct path_buffer *b, int capacity)
+{
+	if (capacity <= b->capacity)
+		return;
+	b->ox = realloc_or_die(b->ox, capacity * sizeof(double));
+	b->oy = realloc_or_die(b->oy, capacity * sizeof(double));
+	b->oz = realloc_or_die(b->oz, capacity * sizeof(double));
+	b->dx = realloc_or_die(b->dx, capacity * sizeof(double));
+	b->dy = realloc_or_die(b->dy, capacity * sizeof(double));
+	b->dz = realloc_or_die(b->dz, capacity * sizeof(double));
+	b->tr = realloc_or_die(b->tr, capacity * sizeof(double));
+	b->tg = realloc_or_die(b->tg, capacity * sizeof(double));
+	b->tb = realloc_or_die(b->tb, capacity * sizeof(double));
+	b->t = realloc_or_die(b->t, capacity * sizeof(double));
+	b->id = realloc_or_die(b->id, capacity * sizeof(int));
+	b->depth = realloc_or_die(b->depth, capacity * sizeof(int));
+	b->slot = realloc_or_die(b->slot, capacity * sizeof(int));
+	b->path = realloc_or_die(b->path, capacity * sizeof(*b->path));
+	b->u = realloc_or_die(b->u, capacity * sizeof(*b->u));
+	b->capacity = capacity;
+}
+
+static void path_buffer_free(struct path_buffer *b)
+{
+	free(b->ox); free(b->oy); free(b->oz);
+	free(b->dx); free(b->dy); free(b->dz);
+	free(b->tr); free(b->tg); free(b->tb);
+	free(b->t); free(b->id); free(b->depth); free(b->slot); free(b->path);
+	free(b->u);
+}
+
+/* ajoute au lot b un chemin d'origine o, de direction d, de poids w */
+static inline int path_push(struct path_buffer *b, const double *o, const double *d, const double *w,
+		int depth, int slot, const struct rng_path *path)
+{
+	int k = b->n++;
+	b->ox[k] = o[0]; b->oy[k] = o[1]; b->oz[k] = o[2];
+	b->dx[k] = d[0]; b->dy[k] = d[1]; b->dz[k] = d[2];
+	b->tr[k] = w[0]; b->tg[k] = w[1]; b->tb[k] = w[2];
+	b->depth[k] = depth;
+	b->slot[k] = slot;
+	b->path[k] = *path;
+	return k;
+}
+
+/* point d'intersection x, normale n et normale orientée nl du chemin k */
+static inline void path_hit_geometry(const struct path_buffer *b, int k, double *x, double *n, double *nl)
+{
+	const struct Sphere *obj = &spheres[b->id[k]];
+	x[0] = b->ox[k] + b->t[k] * b->dx[k];
+	x[1] = b->oy[k] + b->t[k] * b->dy[k];
+	x[2] = b->oz[k] + b->t[k] * b->dz[k];
+	copy(x, n);
+	axpy(-1, obj->position, n);
+	normalize(n);
+	copy(n, nl);
+	if (n[0] * b->dx[k] + n[1] * b->dy[k] + n[2] * b->dz[k] > 0)
+		scal(-1, nl);
+}
+
+/* calcule la ligne i de l'image (pixels dans row, de gauche à droite) avec le moteur wavefront */
+static void wavefront_row(const struct camera *cam, int i, int samples, double *row)
+{
+	struct path_buffer cur = {0}, next = {0};
+	int *q_diff = NULL, *q_spec = NULL, *q_refr = NULL;
+	int q_capacity = 0;
+	const int w = cam->w;
+	const long long total = 4LL * w * samples;      /* chemins caméra de la ligne */
+	double *acc = calloc(4 * w * 3, sizeof(double));  /* somme des échantillons de chaque sous-pixel */
+	if (acc == NULL) {
+		perror("Impossible d'allouer les accumulateurs");
+		exit(1);
+	}
+
+	for (long long first = 0; first < total; first += WAVEFRONT_BATCH) {
+		/* génère un lot de rayons caméra ; chemin c = (pixel j, sous-pixel, échantillon s) */
+		long long last = (total - first < WAVEFRONT_BATCH) ? total : first + WAVEFRONT_BATCH;
+		path_buffer_reserve(&cur, last - first);
+		for (long long c = first; c < last; c++) {
+			cur.path[c - first] = rng_path_init(i, (c / samples) / 4, (c / samples) % 4, c % samples);
+			cur.depth[c - first] = 0;
+		}
+		render_sampler->uniform4_n(cur.path, cur.depth, last - first, cur.u);
+		cur.n = 0;
+		for (long long c = first; c < last; c++) {
+			int slot = c / samples;
+			int j = slot / 4, sub = slot % 4;
+			double o[3], d[3], one[3] = {1, 1, 1};
+			camera_ray(cam, i, j, sub / 2, sub % 2, cur.u[c - first], o, d);
+			path_push(&cur, o, d, one, 0, slot, &cur.path[c - first]);
+		}
+
+		while (cur.n > 0) {
+			/* 1. intersection */
+			/* (une sphère par voie et un rayon à la fois : sur cette scène c'est nettement
+			   plus rapide que scene_intersect_stream(), qui met un rayon par voie) */
+			for (int k = 0; k < cur.n; k++) {
+				double o[3] = {cur.ox[k], cur.oy[k], cur.oz[k]};
+				double d[3] = {cur.dx[k], cur.dy[k], cur.dz[k]};
+				if (!scene_intersect(&scene_compilee, o, d, &cur.t[k], &cur.id[k]))
+					cur.id[k] = -1;
+			}
+			nb_rayons += cur.n;
+
+			/* tirages aléatoires du rebond suivant, pour tout le lot d'un coup */
+			for (int k = 0; k < cur.n; k++)
+				cur.depth[k]++;
+			render_sampler->uniform4_n(cur.path, cur.depth, cur.n, cur.u);
+
+			/* 2. terminaison et tri par matériau */
+			if (q_capacity < cur.n) {
+				q_capacity = cur.capacity;
+				q_diff = realloc_or_die(q_diff, q_capacity * sizeof(int));
+				q_spec = realloc_or_die(q_spec, q_capacity * sizeof(int));
+				q_refr = realloc_or_die(q_refr, q_capacity * sizeof(int));
+			}
+			int nd = 0, ns = 0, nr = 0;
+			for (int k = 0; k < cur.n; k++) {
+				if (cur.id[k] < 0)
+					continue;                 /* perdu : noir */
+				const struct Sphere *obj = &spheres[cur.id[k]];
+				double *a = acc + 3 * cur.slot[k];
+				a[0] += cur.tr[k] * obj->emission[0];
+				a[1] += cur.tg[k] * obj->emission[1];
+				a[2] += cur.tb[k] * obj->emission[2];
+				double q = 1;
+				if (cur.depth[k] > KILL_DEPTH) {
+					double p = obj->max_reflexivity;
+					if (cur.u[k][0] >= p)
+						continue;             /* roulette russe : le chemin s'arrête */
+					q = 1 / p;
+				}
+				cur.tr[k] *= obj->color[0] * q;
+				cur.tg[k] *= obj->color[1] * q;
+				cur.tb[k] *= obj->color[2] * q;
+				if (obj->refl == DIFF)
+					q_diff[nd++] = k;
+				else if (obj->refl == SPEC)
+					q_spec[ns++] = k;
+				else
+					q_refr[nr++] = k;
+			}
+
+			/* 3. ombrage, une file après l'autre ; un chemin REFR peut en produire deux */
+			path_buffer_reserve(&next, nd + ns + 2 * nr);
+			next.n = 0;
+
+			for (int q = 0; q < nd; q++) {
+				int k = q_diff[q];
+				double x[3], n[3], nl[3];
+				path_hit_geometry(&cur, k, x, n, nl);
+				double r1 = 2 * M_PI * cur.u[k][1];
+				double r2 = cur.u[k][2];
+				double r2s = sqrt(r2);
+				double u[3], v[3], d[3];
+				double uw[3] = {0, 0, 0};
+				if (fabs(nl[0]) > .1)
+					uw[1] = 1;
+				else
+					uw[0] = 1;
+				cross(uw, nl, u);
+				normalize(u);
+				cross(nl, u, v);
+				zero(d);
+				axpy(cos(r1) * r2s, u, d);
+				axpy(sin(r1) * r2s, v, d);
+				axpy(sqrt(1 - r2), nl, d);
+				normalize(d);
+				double wk[3] = {cur.tr[k], cur.tg[k], cur.tb[k]};
+				path_push(&next, x, d, wk, cur.depth[k], cur.slot[k], &cur.path[k]);
+			}
+
+			for (int q = 0; q < ns; q++) {
+				int k = q_spec[q];
+				double x[3], n[3], nl[3];
+				path_hit_geometry(&cur, k, x, n, nl);
+				double d[3] = {cur.dx[k], cur.dy[k], cur.dz[k]};
+				axpy(-2 * dot(n, d), n, d);
+				double wk[3] = {cur.tr[k], cur.tg[k], cur.tb[k]};
+				path_push(&next, x, d, wk, cur.depth[k], cur.slot[k], &cur.path[k]);
+			}
+
+			for (int q = 0; q < nr; q++) {
+				int k = q_refr[q];
+				double x[3], n[3], nl[3];
+				path_hit_geometry(&cur, k, x, n, nl);
+				double d[3] = {cur.dx[k], cur.dy[k], cur.dz[k]};
+				double reflected_dir[3];
+				copy(d, reflected_dir);
+				axpy(-2 * dot(n, d), n, reflected_dir);
+				double wk[3] = {cur.tr[k], cur.tg[k], cur.tb[k]};
+
+				bool into = dot(n, nl) > 0;      /* vient-il de l'extérieur ? */
+				double nc = 1;                   /* indice de réfraction de l'air */
+				double nt = 1.5;                 /* indice de réfraction du verre */
+				double nnt = into ? (nc / nt) : (nt / nc);
+				double ddn = dot(d, nl);
+				double cos2t = 1 - nnt * nnt * (1 - ddn * ddn);
+				if (cos2t < 0) {                 /* réflexion totale */
+					path_push(&next, x, reflected_dir, wk, cur.depth[k], cur.slot[k], &cur.path[k]);
+					continue;
+				}
+				double tdir[3];
+				zero(tdir);
+				axpy(nnt, d, tdir);
+				axpy(-(into ? 1 : -1) * (ddn * nnt + sqrt(cos2t)), n, tdir);
+				double a = nt - nc;
+				double b = nt + nc;
+				double R0 = a * a / (b * b);
+				double c = 1 - (into ? -ddn : dot(tdir, n));
+				double Re = R0 + (1 - R0) * c * c * c * c * c;   /* réflectance */
+				double Tr = 1 - Re;                              /* transmittance */
+				if (cur.depth[k] > SPLIT_DEPTH) {
+					double P = .25 + .5 * Re;             /* probabilité de réflection */
+					if (cur.u[k][3] < P) {
+						scal(Re / P, wk);
+						path_push(&next, x, reflected_dir, wk, cur.depth[k], cur.slot[k], &cur.path[k]);
+					} else {
+						scal(Tr / (1 - P), wk);
+						path_push(&next, x, tdir, wk, cur.depth[k], cur.slot[k], &cur.path[k]);
+					}
+				} else {
+					/* les deux branches ; la branche réfractée a ses propres tirages */
+					double wr[3];
+					copy(wk, wr);
+					scal(Re, wr);
+					path_push(&next, x, reflected_dir, wr, cur.depth[k], cur.slot[k], &cur.path[k]);
+					struct rng_path path_tr = cur.path[k];
+					path_tr.branch |= 1u << cur.depth[k];
+					scal(Tr, wk);
+					path_push(&next, x, tdir, wk, cur.depth[k], cur.slot[k], &path_tr);
+				}
+			}
+
+			struct path_buffer tmp = cur;
+			cur = next;
+			next = tmp;
+		}
+	}
+
+	/* moyenne par sous-pixel, troncature, puis moyenne des 4 sous-pixels */
+	for (int j = 0; j < w; j++) {
+		double pixel_radiance[3] = {0, 0, 0};
+		for (int sub = 0; sub < 4; sub++) {
+			double subpixel_radiance[3];
+			copy(acc + 3 * (4 * j + sub), subpixel_radiance);
+			scal(1. / samples, subpixel_radiance);
+			clamp(subpixel_radiance);
+			axpy(0.25, subpixel_radiance, pixel_radiance);
+		}
+		copy(pixel_radiance, row + 3 * j);
+	}
+	path_buffer_free(&cur);
+	path_buffer_free(&next);
+	free(q_diff);
+	free(q_spec);
+	free(q_refr);
+	free(acc);
+}
+
+/* render_pixel() avec --recursive (radiance_recursive) ou --packet N (radiance_packet) :
+   mêmes chemins, mêmes tirages aléatoires */
+static void render_pixel_variante(const struct camera *cam, int i, int j, int samples, double *out)
+{
+	double pixel_radiance[3] = {0, 0, 0};
+	for (int sub_i = 0; sub_i < 2; sub_i++) {
+		for (int sub_j = 0; sub_j < 2; sub_j++) {
+			double subpixel_radiance[3] = {0, 0, 0};
+			for (int s = 0; s < samples && taille_paquet == 0; s++) { 
+				struct rng_path path = rng_path_init(i, j, 2 * sub_i + sub_j, s);
+				double u[4], ray_origin[3], ray_direction[3];
+				render_sampler->uniform4(&path, 0, 0, u);
+				camera_ray(cam, i, j, sub_i, sub_j, u, ray_origin, ray_direction);
+				double sample_radiance[3];
+				radiance_recursive(ray_origin, ray_direction, 0, &path, sample_radiance);
+				axpy(1. / samples, sample_radiance, subpixel_radiance);
+			}
+			/* --packet : taille_paquet rayons à la fois */
+			for (int s = 0; s < samples && taille_paquet > 0; s += taille_paquet) { 
+				struct ray_packet paquet;
+				struct rng_path path[PACKET_MAX];
+				int depth[PACKET_MAX] = {0};
+				double u[PACKET_MAX][4];
+				paquet.n = (samples - s < taille_paquet) ? samples - s : taille_paquet;
+				for (int k = 0; k < paquet.n; k++)
+					path[k] = rng_path_init(i, j, 2 * sub_i + sub_j, s + k);
+				render_sampler->uniform4_n(path, depth, paquet.n, u);
+				for (int k = 0; k < paquet.n; k++) {
+					double ray_origin[3], ray_direction[3];
+					camera_ray(cam, i, j, sub_i, sub_j, u[k], ray_origin, ray_direction);
+					packet_set(&paquet, k, ray_origin, ray_direction);
+				}
+				double sample_radiance[PACKET_MAX][3];
+				radiance_packet(&paquet, 0, path, sample_radiance);
+				for (int k = 0; k < paquet.n; k++)
+					axpy(1. / samples, sample_radiance[k], subpixel_radiance);
+			}
+			clamp(subpixel_radiance); //S'assure que les coef de subpixel_radiance soient compris entre 0 et 1
+			/* fait la moyenne sur les 4 sous-pixels */
+			axpy(0.25, subpixel_radiance, pixel_radiance);
+		}
+	}
+	copy(pixel_radiance, out);
+}
+
 double wtime()
 {
 	struct timeval ts;
@@ -341,13 +694,108 @@ double wtime()
 	return (double)ts.tv_sec + ts.tv_usec / 1E6;
 }
 
-int toInt(double x)
+/* image[] est rangée ligne de caméra i ; le fichier commence par le haut */
+static void retourne_image(const double *pixels, double *image, int w, int h)
 {
-	return pow(x, 1 / 2.2) * 255 + .5;   /* gamma correction = 2.2 */
-} 
+	for (int i = 0; i < h; i++)
+		memcpy(image + 3 * (h - 1 - i) * w, pixels + 3 * i * w, 3 * w * sizeof(*pixels)); // <-- retournement vertical
+}
+
+/* --denoise : filtre image (rangée comme le fichier, le haut d'abord) en place */
+static void debruite(const struct gbuffer *gb, double *image)
+{
+	struct denoise dn;
+	denoise_defaut(&dn);
+	double *filtree = malloc(3 * gb->w * gb->h * sizeof(*filtree));
+	if (filtree == NULL) {
+		perror("Impossible d'allouer l'image débruitée");
+		exit(1);
+	}
+	denoise_image(&dn, gb, image, filtree);
+	memcpy(image, filtree, 3 * gb->w * gb->h * sizeof(*image));
+	free(filtree);
+}
+
+/* --progressive, --time-budget : passes de plus en plus longues (un quart des
+   échantillons déjà accumulés), point de reprise (si reprise) et image (débruitée
+   si gb) écrits après chaque passe ; si echeance > 0, la dernière passe est
+   raccourcie pour finir avant wtime() == echeance */
+static int rendu_progressif(const struct camera *cam, const char *reprise, int samples, double echeance,
+		const struct gbuffer *gb, double *image)
+{
+	int w = cam->w, h = cam->h;
+	struct progressif pg;
+	progressif_init(&pg, w, h, progressif_hash(&scene_compilee));
+	if (reprise != NULL && progressif_load(&pg, reprise))
+		fprintf(stderr, "reprise de %s : %u échantillons par sous-pixel\n", reprise, pg.n);
+	double *pixels = malloc(3 * w * h * sizeof(*pixels));
+	if (pixels == NULL) {
+		perror("Impossible d'allouer l'image");
+		exit(1);
+	}
+
+	uint32_t n_repris = pg.n;
+	double debut = wtime();
+	double cout = 0;        /* secondes par échantillon de chaque sous-pixel (passe précédente) */
+	double fixe = 0;        /* point de reprise, débruitage et écriture de l'image */
+	while (pg.n < (uint32_t) samples) {
+		int pas = progressif_pas(pg.n, samples - pg.n, (echeance > 0) ? cout : 0, echeance - fixe - wtime());
+		if (pas == 0)
+			break;
+		double t = wtime();
+		nb_rayons += progressif_passe(&pg, &scene_compilee, cam, pas);
+		cout = (wtime() - t) / pas;
+		t = wtime();
+		if (reprise != NULL && !progressif_save(&pg, reprise))
+			fprintf(stderr, "impossible d'écrire le point de reprise %s\n", reprise);
+		progressif_image(&pg, pixels);
+		retourne_image(pixels, image, w, h);
+		if (gb != NULL)
+			debruite(gb, image);
+		ppm_ecrit("/tmp/", "image_test.ppm", image, w, h, false);
+		fixe = wtime() - t;
+		fprintf(stderr, "passe : %u échantillons par sous-pixel, %.2f s\n", pg.n, wtime() - debut);
+	}
+	if (pg.n == 0) {
+		fprintf(stderr, "--progressive : aucun échantillon\n");
+		exit(1);
+	}
+	/* image de la dernière passe, ou du point de reprise s'il avait déjà assez d'échantillons */
+	progressif_image(&pg, pixels);
+	retourne_image(pixels, image, w, h);
+	free(pixels);
+	int ajoutes = pg.n - n_repris;
+	progressif_free(&pg);
+	return ajoutes;
+}
+
+/* --adaptive : répartition des échantillons par sous-pixel entre les pixels */
+static void rapport_adaptatif(const struct adaptatif *ad, const struct pixel_stats *stats, int nb_pixels)
+{
+	long long total = 0;
+	int convergents = 0, n_min = stats[0].n, n_max = stats[0].n;
+	int classes[32] = {0};         /* pixels par puissance de 2 du nombre d'échantillons */
+	for (int p = 0; p < nb_pixels; p++) {
+		int n = stats[p].n;
+		total += n;
+		convergents += (adaptatif_erreur(&stats[p]) <= ad->cible);
+		n_min = (n < n_min) ? n : n_min;
+		n_max = (n > n_max) ? n : n_max;
+		if (n > 0)
+			classes[31 - __builtin_clz(n)]++;
+	}
+	fprintf(stderr, "adaptatif : %.1f échantillons par sous-pixel en moyenne (budget %.1f), de %d à %d ; "
+			"%d pixels sous l'erreur %g\n", (double) total / nb_pixels, (double) ad->budget / nb_pixels,
+			n_min, n_max, convergents, ad->cible);
+	for (int c = 0; c < 32; c++)
+		if (classes[c] > 0)
+			fprintf(stderr, "  %6d - %6d : %6d pixels\n", 1 << c, (2 << c) - 1, classes[c]);
+}
 
 int main(int argc, char **argv)
 { 
+	double lancement = wtime();        /* --time-budget compte depuis le lancement */
+
 	/* Petit cas test (small, quick and dirty): */
 	int w = 320;
 	int h = 200;
@@ -358,103 +806,203 @@ int main(int argc, char **argv)
 	/* int h = 2160; */
 	/* int samples = 5000;  */
 
-	if (argc == 2) 
-		samples = atoi(argv[1]) / 4;
-
-	static const double CST = 0.5135;  /* ceci défini l'angle de vue */
-	double camera_position[3] = {50, 52, 295.6};
-	double camera_direction[3] = {0, -0.042612, -1};
-	normalize(camera_direction);
-
-	/* incréments pour passer d'un pixel à l'autre */
-	double cx[3] = {w * CST / h, 0, 0};    
-	double cy[3];
-	cross(cx, camera_direction, cy);  /* cross: produit vectoriel. cy est orthogonal à cx ET à la direction dans laquelle regarde la caméra */
-	normalize(cy);
-	scal(CST, cy);
-
-	/* précalcule la norme infinie des couleurs */
-	int n = sizeof(spheres) / sizeof(struct Sphere); //Nombre de sphères dans le tableau sphère
-	for (int i = 0; i < n; i++) {//La valeure la plus élevé parmis les 3 composantes RGB devient la valeure de la reflexivité
-		double *f = spheres[i].color;
-		if ((f[0] > f[1]) && (f[0] > f[2]))
-			spheres[i].max_reflexivity = f[0]; 
-		else {
-			if (f[1] > f[2])
-				spheres[i].max_reflexivity = f[1];
-			else
-				spheres[i].max_reflexivity = f[2]; 
+	const char *fichier_scene = NULL;  /* --scene : fichier texte ou binaire */
+	const char *sauve_scene = NULL;    /* --save-scene : écrit la scène au format binaire */
+	bool adaptatif = false;            /* --adaptive : samples est un budget moyen, réparti selon l'erreur */
+	double cible = 0;                  /* --error : erreur relative visée par pixel */
+	const char *reprise = NULL;        /* --progressive : point de reprise, relu s'il existe */
+	bool debruitage = false;           /* --denoise : filtre guidé de l'image finale */
+	double budget = 0;                 /* --time-budget : secondes, depuis le lancement */
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "--scene") == 0 && a + 1 < argc)
+			fichier_scene = argv[++a];
+		else if (strcmp(argv[a], "--sampler") == 0 && a + 1 < argc) {
+			render_sampler = sampler_find(argv[++a]);
+			if (render_sampler == NULL) {
+				fprintf(stderr, "--sampler : philox ou sobol\n");
+				exit(1);
+			}
+		} else if (strcmp(argv[a], "--save-scene") == 0 && a + 1 < argc)
+			sauve_scene = argv[++a];
+		else if (strcmp(argv[a], "--scalar") == 0)
+			render_scalaire = true;
+		else if (strcmp(argv[a], "--nee") == 0)
+			render_nee = true;
+		else if (strcmp(argv[a], "--recursive") == 0)
+			radiance_recursive_mode = true;
+		else if (strcmp(argv[a], "--wavefront") == 0)
+			wavefront = true;
+		else if (strcmp(argv[a], "--adaptive") == 0)
+			adaptatif = true;
+		else if (strcmp(argv[a], "--progressive") == 0 && a + 1 < argc)
+			reprise = argv[++a];
+		else if (strcmp(argv[a], "--denoise") == 0)
+			debruitage = true;
+		else if (strcmp(argv[a], "--order") == 0 && a + 1 < argc) {
+			if (!tuiles_ordre_cherche(argv[++a], &tuiles_ordre)) {
+				fprintf(stderr, "--order : lines, morton ou hilbert\n");
+				exit(1);
+			}
+		}
+		else if (strcmp(argv[a], "--bind") == 0 && a + 1 < argc) {
+			if (!placement_cherche(argv[++a], &placement_epinglage)) {
+				fprintf(stderr, "--bind : none, compact ou spread\n");
+				exit(1);
+			}
 		}
+		else if (strcmp(argv[a], "--huge-pages") == 0)
+			placement_grandes_pages = true;
+		else if (strcmp(argv[a], "--task-depth") == 0 && a + 1 < argc) {
+			render_task_depth = atoi(argv[++a]);
+			if (render_task_depth < 0 || render_task_depth > SPLIT_DEPTH) {
+				fprintf(stderr, "--task-depth : de 0 à %d\n", SPLIT_DEPTH);
+				exit(1);
+			}
+		}
+		else if (strcmp(argv[a], "--time-budget") == 0 && a + 1 < argc)
+			budget = atof(argv[++a]);
+		else if (strcmp(argv[a], "--error") == 0 && a + 1 < argc) {
+			adaptatif = true;
+			cible = atof(argv[++a]);
+		}
+		else if (strcmp(argv[a], "--packet") == 0 && a + 1 < argc) {
+			taille_paquet = atoi(argv[++a]);
+			if (taille_paquet != 4 && taille_paquet != 8 && taille_paquet != 16) {
+				fprintf(stderr, "--packet : taille 4, 8 ou 16\n");
+				exit(1);
+			}
+		} else
+			samples = atoi(argv[a]) / 4;
+	}
+	if (render_nee && (wavefront || radiance_recursive_mode)) {
+		fprintf(stderr, "--nee : seulement avec radiance() itérative (ou --packet)\n");
+		exit(1);
+	}
+	if (render_task_depth > 0 && wavefront) {
+		fprintf(stderr, "--task-depth : pas avec --wavefront\n");
+		exit(1);
+	}
+	bool progressif = reprise != NULL || budget > 0;
+	if ((adaptatif || progressif) && (wavefront || radiance_recursive_mode || taille_paquet > 0)) {
+		fprintf(stderr, "--adaptive, --progressive, --time-budget : seulement avec radiance() itérative\n");
+		exit(1);
+	}
+	if (adaptatif && progressif) {
+		fprintf(stderr, "--adaptive ne se combine pas avec --progressive ou --time-budget\n");
+		exit(1);
 	}
 
-	/* boucle principale */
-	double *image = malloc(3 * w * h * sizeof(*image));
-	if (image == NULL) {
-		perror("Impossible d'allouer l'image");
+	struct camera cam;
+	camera_init(&cam, w, h);
+
+	/* charge la scène (fichier texte ou binaire, Cornell par défaut) */
+	scene_load(&scene_compilee, fichier_scene);
+	spheres = scene_compilee.spheres;
+	if (sauve_scene != NULL && !scene_save(&scene_compilee, sauve_scene)) {
+		perror(sauve_scene);
 		exit(1);
 	}
 
-	for (int i = 0; i < h; i++) {
- 		unsigned short PRNG_state[3] = {0, 0, i*i*i};
-		for (unsigned short j = 0; j < w; j++) {
-			/* calcule la luminance d'un pixel, avec sur-échantillonnage 2x2 */
-			double pixel_radiance[3] = {0, 0, 0};
-			for (int sub_i = 0; sub_i < 2; sub_i++) {
-				for (int sub_j = 0; sub_j < 2; sub_j++) {
-					double subpixel_radiance[3] = {0, 0, 0};
-					/* simulation de monte-carlo : on effectue plein de lancers de rayons et on moyenne */
-					for (int s = 0; s < samples; s++) { 
-						/* tire un rayon aléatoire dans une zone de la caméra qui correspond à peu près au pixel à calculer */
-						double r1 = 2 * erand48(PRNG_state);
-						double dx = (r1 < 1) ? sqrt(r1) - 1 : 1 - sqrt(2 - r1); 
-						double r2 = 2 * erand48(PRNG_state);
-						double dy = (r2 < 1) ? sqrt(r2) - 1 : 1 - sqrt(2 - r2);
-						double ray_direction[3];
-						copy(camera_direction, ray_direction);
-						axpy(((sub_i + .5 + dy) / 2 + i) / h - .5, cy, ray_direction);
-						axpy(((sub_j + .5 + dx) / 2 + j) / w - .5, cx, ray_direction);
-						normalize(ray_direction);
-
-						double ray_origin[3];
-						copy(camera_position, ray_origin);
-						axpy(140, ray_direction, ray_origin);
-						
-						/* estime la lumiance qui arrive sur la caméra par ce rayon */
-						double sample_radiance[3];
-						radiance(ray_origin, ray_direction, 0, PRNG_state, sample_radiance); //void radiance(const double *ray_origin, const double *ray_direction, int depth, unsigned short *PRNG_state, double *out)
-
-						/* fait la moyenne sur tous les rayons */
-						axpy(1. / samples, sample_radiance, subpixel_radiance);
-					}
-					clamp(subpixel_radiance); //S'assure que les coef de subpixel_radiance soient compris entre 0 et 1
-					/* fait la moyenne sur les 4 sous-pixels */
-					axpy(0.25, subpixel_radiance, pixel_radiance);
+	/* threads épinglés une fois pour toutes (--bind) : les régions parallèles
+	   suivantes réutilisent les mêmes threads */
+	placement_init(0, 1, omp_get_max_threads());
+	#pragma omp parallel
+	placement_epingle(omp_get_thread_num(), omp_get_num_threads());
+
+	/* boucle principale */
+	/* réservée sans être touchée : chaque page est placée par le premier thread
+	   qui l'écrit (voir placement.h) ; alignée sur les pages, donc sur les lignes
+	   de cache : une tuile de TUILE_TAILLE pixels (384 octets par ligne) n'en
+	   partage pas avec ses voisines si w est un multiple de 8 */
+	size_t taille_image = 3 * w * h * sizeof(double);
+	double *image = placement_alloc(taille_image);
+
+	/* tampons de guidage du débruitage, dans l'ordre du fichier */
+	struct gbuffer gb;
+	if (debruitage)
+		gbuffer_init(&gb, &scene_compilee, &cam, true);
+
+	double debut = wtime();
+	if (adaptatif) {
+		struct adaptatif ad;
+		adaptatif_defaut(&ad, samples, w * h);
+		ad.cible = cible;
+		struct pixel_stats *stats = malloc(w * h * sizeof(*stats));
+		double *pixels = malloc(3 * w * h * sizeof(*pixels));
+		if (stats == NULL || pixels == NULL) {
+			perror("Impossible d'allouer les statistiques des pixels");
+			exit(1);
+		}
+		nb_rayons = adaptatif_rendu(&scene_compilee, &cam, &ad, 0, w * h, stats, pixels, NULL);
+		retourne_image(pixels, image, w, h);
+		rapport_adaptatif(&ad, stats, w * h);
+		free(stats);
+		free(pixels);
+	} else if (progressif)
+		samples = rendu_progressif(&cam, reprise, samples, (budget > 0) ? lancement + budget : 0,
+				debruitage ? &gb : NULL, image);
+	if (!adaptatif && !progressif) {
+		/* tuiles de TUILE_TAILLE pixels : chaque thread a un bloc contigu de la courbe
+		   (--order) dans sa file et vole celles des autres quand la sienne est vide ;
+		   il écrit d'abord à zéro les pixels de son bloc, qui sont donc dans la
+		   mémoire de son nœud. Chaque pixel ne dépend que de (i, j) : l'image ne
+		   dépend ni du nombre de threads ni de l'ordre */
+		int nb_threads = omp_get_max_threads();
+		struct tuiles tp;
+		tuiles_init(&tp, w, h, wavefront ? 0 : nb_threads);
+		if (!wavefront)
+			tuiles_repartit(&tp, 0, tp.nb, nb_threads);
+		long long total = 0;
+		#pragma omp parallel num_threads(nb_threads)
+		{
+			nb_rayons = 0;
+			if (wavefront) {
+				#pragma omp for schedule(dynamic)
+				for (int i = 0; i < h; i++)
+					wavefront_row(&cam, i, samples, image + 3 * (h - 1 - i) * w); // <-- retournement vertical
+			} else {
+				int moi = omp_get_thread_num(), tuile;
+				unsigned graine = 2654435761u * (moi + 1);
+				tuiles_premier_contact(&tp, 0, tp.nb, nb_threads, moi, image, true);
+				#pragma omp barrier
+				while (tuiles_prend(&tp, moi, &graine, &tuile)) {
+					int x0, y0, x1, y1;
+					tuiles_pixels(&tp, tuile, &x0, &y0, &x1, &y1);
+					for (int i = y0; i < y1; i++)
+						for (int j = x0; j < x1; j++) {
+							double pixel_radiance[3];
+							if (radiance_recursive_mode || taille_paquet > 0)
+								render_pixel_variante(&cam, i, j, samples, pixel_radiance);
+							else
+								nb_rayons += render_pixel(&scene_compilee, &cam, i, j, samples, pixel_radiance);
+							copy(pixel_radiance, image + 3 * ((h - 1 - i) * w + j)); // <-- retournement vertical
+						}
 				}
 			}
-			copy(pixel_radiance, image + 3 * ((h - 1 - i) * w + j)); // <-- retournement vertical
-			//copy(pixel_radiance, image + 3 * ((i) * w + j)); // <-- retournement vertical
+			/* les threads qui n'ont plus de tuiles prennent ici les tâches de --task-depth
+			   (et comptent leurs rayons) */
+			#pragma omp barrier
+			#pragma omp atomic
+			total += nb_rayons;
 		}
-		
+		nb_rayons = total;
+		tuiles_free(&tp);
 	}
-	fprintf(stderr, "\n");
-
-	/* stocke l'image dans un fichier au format NetPbm */
-	{
-		struct passwd *pass; 
-		char nom_sortie[100] = "";
-		char nom_rep[30] = "";
-
-		pass = getpwuid(getuid()); 
-		sprintf(nom_rep, "/tmp/%s", pass->pw_name);
-		mkdir(nom_rep, S_IRWXU);
-		sprintf(nom_sortie, "%s/image_test.ppm", nom_rep);
-		
-		FILE *f = fopen(nom_sortie, "w");
-		fprintf(f, "P3\n%d %d\n%d\n", w, h, 255); 
-		for (int i = 0; i < w * h; i++) 
-	  		fprintf(f,"%d %d %d ", toInt(image[3 * i]), toInt(image[3 * i + 1]), toInt(image[3 * i + 2])); 
-		fclose(f); 
+	double fin = wtime();
+	fprintf(stderr, "intersection %s, radiance %s, %d threads : %.2f s, %.2f Mrayons/s, %.3f µs/échantillon\n",
+		render_scalaire ? "scalaire" : scene_simd_name(),
+		wavefront ? "wavefront" : (radiance_recursive_mode ? "récursive" : (render_nee ? "itérative + NEE" : "itérative")),
+		omp_get_max_threads(), fin - debut, nb_rayons / (fin - debut) / 1e6, (fin - debut) * 1e6 / (4. * w * h * samples));
+	placement_rapport(stderr, "placement", image, taille_image);
+
+	if (debruitage) {
+		double t = wtime();
+		debruite(&gb, image);
+		fprintf(stderr, "débruitage : %.3f s\n", wtime() - t);
+		gbuffer_free(&gb);
 	}
+	ppm_ecrit("/tmp/", "image_test.ppm", image, w, h, false);
 
-	free(image);
+	placement_free(image, taille_image);
+	scene_free(&scene_compilee);
 }
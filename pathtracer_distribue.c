@@ -0,0 +1,163 @@
+/* basé sur on smallpt, a Path Tracer by Kevin Beason, 2008
+ *  	http://www.kevinbeason.com/smallpt/
+ *
+ * Converti en C et modifié par Charles Bouillaguet, 2019
+ *
+ * Pilote MPI commun : même noyau de rendu (render.h), même scène et même
+ * image pour toutes les stratégies de répartition, choisies à l'exécution
+ * (--strategy static|rows|nodes|ring|random|hybrid, voir distribue.h).
+ */
+
+#define _XOPEN_SOURCE
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <mpi.h>
+#include <string.h>    /* pour strcmp   */
+#include <omp.h>
+
+#include "distribue.h"
+#include "placement.h"
+#include "ppm.h"
+#include "render.h"
+#include "sampler.h"
+#include "scene.h"
+#include "scene_mpi.h"
+#include "tuiles.h"
+
+struct scene scene_compilee;        /* positions et rayons² des sphères, en SoA (voir scene.h) */
+
+/* bilan des processus sur le rang 0 : équilibre du travail et temps perdu à attendre */
+static void bilan(const struct travail *tr, const char *strategie, double debut, double duree)
+{
+	double mesure[3] = {tr->pixels, tr->calcul, (tr->pixels > 0) ? tr->dernier - debut : 0};
+	double *tous = (tr->rang == 0) ? malloc(3 * tr->size * sizeof(double)) : NULL;
+	long long somme[2] = {tr->rayons, tr->messages};
+	MPI_Gather(mesure, 3, MPI_DOUBLE, tous, 3, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+	MPI_Reduce(tr->rang == 0 ? MPI_IN_PLACE : somme, somme, 2, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+	if (tr->rang != 0)
+		return;
+
+	/* fin : dernier pixel de tous ; inactivité d'un processus jusque-là : tout ce qui
+	   n'est pas du calcul, dont la traîne après son propre dernier pixel */
+	double pmin = tous[0], pmax = tous[0], fin = 0, inactif = 0, traine = 0;
+	for (int r = 0; r < tr->size; r++) {
+		pmin = fmin(pmin, tous[3 * r]);
+		pmax = fmax(pmax, tous[3 * r]);
+		fin = fmax(fin, tous[3 * r + 2]);
+	}
+	for (int r = 0; r < tr->size; r++) {
+		inactif += fin - tous[3 * r + 1];
+		traine += fin - tous[3 * r + 2];
+	}
+	fprintf(stderr, "stratégie %s, %d processus : %.2f s, %.2f Mrayons/s ; pixels par processus %.0f .. %.0f ; "
+			"%lld messages ; inactivité moyenne %.3f s, dont %.3f s après le dernier pixel du processus\n",
+			strategie, tr->size, duree, somme[0] / duree / 1e6, pmin, pmax, somme[1],
+			inactif / tr->size, traine / tr->size);
+	free(tous);
+}
+
+int main(int argc, char **argv)
+{
+	/* Petit cas test (small, quick and dirty): */
+	int w = 320;
+	int h = 200;
+	int samples = 200;
+
+	const char *fichier_scene = NULL;  /* --scene : lu par le rang 0 seulement */
+	const struct strategie *strategie = strategie_cherche("ring");
+	for (int a = 1; a < argc; a++) {
+		if (strcmp(argv[a], "--scene") == 0 && a + 1 < argc)
+			fichier_scene = argv[++a];
+		else if (strcmp(argv[a], "--sampler") == 0 && a + 1 < argc) {
+			render_sampler = sampler_find(argv[++a]);
+			if (render_sampler == NULL) {
+				fprintf(stderr, "--sampler : philox ou sobol\n");
+				exit(1);
+			}
+		} else if (strcmp(argv[a], "--strategy") == 0 && a + 1 < argc) {
+			strategie = strategie_cherche(argv[++a]);
+			if (strategie == NULL) {
+				fprintf(stderr, "--strategy : static, rows, nodes, ring, random ou hybrid\n");
+				exit(1);
+			}
+		} else if (strcmp(argv[a], "--order") == 0 && a + 1 < argc) {
+			if (!tuiles_ordre_cherche(argv[++a], &tuiles_ordre)) {
+				fprintf(stderr, "--order : lines, morton ou hilbert\n");
+				exit(1);
+			}
+		} else if (strcmp(argv[a], "--bind") == 0 && a + 1 < argc) {
+			if (!placement_cherche(argv[++a], &placement_epinglage)) {
+				fprintf(stderr, "--bind : none, compact ou spread\n");
+				exit(1);
+			}
+		} else if (strcmp(argv[a], "--huge-pages") == 0)
+			placement_grandes_pages = true;
+		else if (strcmp(argv[a], "--task-depth") == 0 && a + 1 < argc) {
+			render_task_depth = atoi(argv[++a]);
+			if (render_task_depth < 0 || render_task_depth > SPLIT_DEPTH) {
+				fprintf(stderr, "--task-depth : de 0 à %d\n", SPLIT_DEPTH);
+				exit(1);
+			}
+		} else
+			samples = atoi(argv[a]) / 4;
+	}
+
+	struct camera cam;
+	camera_init(&cam, w, h);
+
+	/* hybrid : seul le thread principal appelle MPI, pendant que d'autres calculent
+	   (sans ce niveau, il se rabat sur ring) */
+	int rang, size, provided;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	MPI_Comm_rank(MPI_COMM_WORLD, &rang);
+
+	/* le rang 0 charge la scène et diffuse la scène compilée */
+	if (rang == 0)
+		scene_load(&scene_compilee, fichier_scene);
+	scene_bcast(&scene_compilee, 0, MPI_COMM_WORLD);
+
+	/* les processus d'un même nœud se partagent ses cœurs (sauf si mpirun les a déjà liés) ;
+	   le thread principal est le processus lui-même */
+	MPI_Comm comm_noeud;
+	int rang_noeud, taille_noeud;
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &comm_noeud);
+	MPI_Comm_rank(comm_noeud, &rang_noeud);
+	MPI_Comm_size(comm_noeud, &taille_noeud);
+	MPI_Comm_free(&comm_noeud);
+	placement_init(rang_noeud, taille_noeud, omp_get_max_threads() + 1);
+	placement_epingle(0, 1);
+
+	/* parcours de l'image (--order) ; l'image, sur le rang 0 seulement (les autres
+	   n'ont que le relevé des pixels qu'ils rendent) */
+	struct tuiles tp;
+	tuiles_init(&tp, w, h, 0);
+	size_t taille_image = (rang == 0) ? 3 * w * h * sizeof(double) : 0;
+	double *image = (rang == 0) ? placement_alloc(taille_image) : NULL;
+
+	struct travail tr = {&scene_compilee, &cam, samples, &tp, rang, size, image};
+	MPI_Barrier(MPI_COMM_WORLD);
+	double debut = MPI_Wtime();
+	strategie->rend(&tr);
+	double fin = MPI_Wtime();
+
+	bilan(&tr, strategie->nom, debut, fin - debut);
+	if (placement_epinglage != EPINGLE_AUCUN || placement_grandes_pages) {
+		char qui[32];
+		sprintf(qui, "rang %d : placement", rang);
+		placement_rapport(stderr, qui, image, taille_image);
+	}
+	if (rang == 0) {
+		ppm_ecrit("", "image.ppm", image, w, h, true);
+		fprintf(stdout, "Pour w=%d, h=%d et samples=%d;  le temps de calcul est %g s\n", w, h, samples, fin - debut);
+	}
+
+	if (image != NULL)
+		placement_free(image, taille_image);
+	tuiles_free(&tp);
+	scene_free(&scene_compilee);
+	MPI_Finalize();
+	return 0;
+}
@@ -0,0 +1,167 @@
+/* Échantillonnage adaptatif (voir adaptatif.h). */
+#include <math.h>
+#include <string.h>
+
+#include "adaptatif.h"
+#include "blas.h"
+#include "rng.h"
+
+/* en dessous d'un niveau de gris, l'erreur relative n'a plus de sens */
+#define LUMINANCE_MIN (1. / 256)
+
+/* écart d'un échantillon fictif ajouté à la variance : sans lui, un pixel
+   dont les premiers chemins n'ont pas touché la lumière (tous noirs) aurait
+   une variance nulle et passerait pour convergé */
+#define ECART_A_PRIORI (1. / 16)
+
+void adaptatif_defaut(struct adaptatif *ad, int samples, int nb_pixels)
+{
+	/* au moins un échantillon par sous-pixel, même pour samples = 0 : la moyenne
+	   d'aucun échantillon n'est pas une couleur */
+	ad->n0 = (samples / 4 > 4) ? samples / 4 : (samples < 4 ? samples : 4);
+	if (ad->n0 < 1)
+		ad->n0 = 1;
+	ad->n_max = (16 * samples > ad->n0) ? 16 * samples : ad->n0;
+	ad->cible = 0;
+	ad->budget = (long long) samples * nb_pixels;
+}
+
+double adaptatif_erreur(const struct pixel_stats *st)
+{
+	if (st->n < 2)
+		return INFINITY;
+	double variance = (st->m2 + ECART_A_PRIORI * ECART_A_PRIORI) / st->n;
+	return sqrt(variance / st->n) / fmax(st->moyenne, LUMINANCE_MIN);
+}
+
+/* classe d'erreur : 0 pour les plus petites, ADAPTATIF_CLASSES - 1 pour les plus grandes */
+static int classe(double erreur)
+{
+	if (!(erreur > 0))
+		return 0;
+	double c = floor(4 * (log2(erreur) + 12));
+	if (c < 0)
+		return 0;
+	return (c >= ADAPTATIF_CLASSES - 1) ? ADAPTATIF_CLASSES - 1 : (int) c;
+}
+
+/* ajoute les échantillons n .. n + nb - 1 de chaque sous-pixel du pixel (i, j) */
+static long long echantillonne(const struct scene *sc, const struct camera *cam, int i, int j, int nb,
+		struct pixel_stats *st)
+{
+	long long nb_rayons = 0;
+	for (int s = st->n; s < st->n + nb; s++) {
+		double lum = 0;
+		for (int sub = 0; sub < 4; sub++) {
+			double e[3];
+			nb_rayons += render_sample(sc, cam, i, j, sub, s, e);
+			axpy(1, e, st->somme[sub]);
+			clamp(e);
+			lum += (e[0] + e[1] + e[2]) / 12;
+		}
+		/* Welford */
+		double delta = lum - st->moyenne;
+		st->moyenne += delta / (s + 1);
+		st->m2 += delta * (lum - st->moyenne);
+	}
+	st->n += nb;
+	return nb_rayons;
+}
+
+/* x arrondi vers le haut avec une probabilité égale à sa partie fractionnaire : en
+   moyenne x ; le tirage ne dépend que du pixel p et du numéro de passe, pas du
+   découpage entre rangs */
+static int arrondi(double x, int p, int passe)
+{
+	uint32_t ctr[4] = {(uint32_t) passe, 0, 0, 0}, key[2] = {(uint32_t) p, 0xADA97A7Fu}, u[4];
+	philox4x32(ctr, key, u);
+	return (int) floor(x + u[0] * 0x1p-32);
+}
+
+/* pas d'un pixel qui n'a pas convergé : on double ses échantillons, sans dépasser n_max */
+static int pas(const struct adaptatif *ad, const struct pixel_stats *st)
+{
+	if (st->n >= ad->n_max || adaptatif_erreur(st) <= ad->cible)
+		return 0;
+	return (2 * st->n > ad->n_max) ? ad->n_max - st->n : st->n;
+}
+
+long long adaptatif_rendu(const struct scene *sc, const struct camera *cam, const struct adaptatif *ad,
+		int debut, int fin, struct pixel_stats *stats, double *out, adaptatif_somme somme)
+{
+	long long nb_rayons = 0;
+	int w = cam->w;
+
+	/* première passe : n0 échantillons partout */
+	memset(stats, 0, (fin - debut) * sizeof(*stats));
+	#pragma omp parallel for schedule(dynamic, 64) reduction(+:nb_rayons)
+	for (int p = debut; p < fin; p++)
+		nb_rayons += echantillonne(sc, cam, p / w, p % w, ad->n0, &stats[p - debut]);
+	long long depense = (long long) ad->n0 * (fin - debut);
+	if (somme != NULL)
+		somme(&depense, 1);
+	long long restant = ad->budget - depense;
+
+	for (int passe = 1; restant > 0; passe++) {
+		/* coût (en échantillons par sous-pixel) de chaque classe d'erreur */
+		long long cout[ADAPTATIF_CLASSES] = {0};
+		for (int p = debut; p < fin; p++)
+			cout[classe(adaptatif_erreur(&stats[p - debut]))] += pas(ad, &stats[p - debut]);
+		if (somme != NULL)
+			somme(cout, ADAPTATIF_CLASSES);
+
+		/* seuil : les classes les plus hautes qui tiennent dans la moitié du
+		   budget restant (l'erreur est réévaluée avant de dépenser l'autre
+		   moitié) ; si la première ne tient pas, ses pixels reçoivent une
+		   fraction de leur pas, arrondie au hasard (tronquée, elle tombait à 0
+		   pour les pas courts, et une partie du budget restait inutilisée) */
+		long long moitie = (restant + 1) / 2;
+		int seuil = ADAPTATIF_CLASSES;
+		long long cumul = 0;
+		double fraction = 1;
+		for (int c = ADAPTATIF_CLASSES - 1; c >= 0; c--) {
+			if (cout[c] == 0)
+				continue;
+			if (cumul + cout[c] > moitie) {
+				if (seuil == ADAPTATIF_CLASSES) {
+					seuil = c;
+					fraction = (double) moitie / cout[c];
+				}
+				break;
+			}
+			cumul += cout[c];
+			seuil = c;
+		}
+		if (seuil == ADAPTATIF_CLASSES)
+			break;            /* tous les pixels ont convergé */
+
+		depense = 0;
+		#pragma omp parallel for schedule(dynamic, 64) reduction(+:nb_rayons, depense)
+		for (int p = debut; p < fin; p++) {
+			struct pixel_stats *st = &stats[p - debut];
+			if (classe(adaptatif_erreur(st)) < seuil)
+				continue;
+			int nb = (fraction < 1) ? arrondi(pas(ad, st) * fraction, p, passe) : pas(ad, st);
+			nb_rayons += echantillonne(sc, cam, p / w, p % w, nb, st);
+			depense += nb;
+		}
+		if (somme != NULL)
+			somme(&depense, 1);
+		restant -= depense;     /* rien dépensé : nouveau tirage à la passe suivante */
+	}
+
+	/* valeur des pixels : comme render_pixel(), moyenne des sous-pixels bornés */
+	for (int p = debut; p < fin; p++) {
+		struct pixel_stats *st = &stats[p - debut];
+		double *pixel = out + 3 * (p - debut);
+		zero(pixel);
+		for (int sub = 0; sub < 4; sub++) {
+			double e[3];
+			copy(st->somme[sub], e);
+			scal(1. / st->n, e);
+			clamp(e);
+			axpy(0.25, e, pixel);
+		}
+	}
+	return nb_rayons;
+}
@@ -0,0 +1,612 @@
+/* Construction (SAH binné) et parcours (petite pile, fils le plus proche d'abord) de la BVH.
+ *
+ * La construction est parallélisée avec OpenMP (-fopenmp) : les deux sous-arbres
+ * d'un grand noeud sont construits par des tâches distinctes, et le binning des
+ * grands noeuds est découpé en morceaux. Sans OpenMP, elle est séquentielle.
+ */
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bvh.h"
+
+#define NB_BINS 16          /* nombre de cases par axe pour l'évaluation de la SAH */
+#define LEAF_MIN 8          /* en dessous, on ne découpe plus */
+#define LEAF_MAX 16         /* au-dessus, on découpe même si la SAH préfère une feuille */
+#define TRAVERSAL_COST 4.0  /* coût d'un noeud interne, relatif au test d'une sphère */
+#define PAR_MIN 4096        /* en dessous, un sous-arbre est construit par une seule tâche */
+#define NB_CHUNKS 32        /* morceaux du binning parallèle */
+
+static const double EPS = 1e-4;
+static const double INF = 1e20;
+
+/* noeud provisoire : pendant la construction parallèle les noeuds sont alloués
+   dans un ordre quelconque, on les remet en profondeur d'abord à la fin */
+struct tmp_node {
+	double min[3], max[3];
+	int left, right;        /* fils (noeud interne) */
+	int first, count;       /* plage de sphères (feuille : count > 0) */
+};
+
+struct build {
+	const double *cx, *cy, *cz;     /* centres */
+	const double *radius;
+	int *prim;                      /* permutation en cours de construction */
+	struct tmp_node *nodes;
+	int nb_nodes;
+};
+
+struct bin {
+	int count;
+	double min[3], max[3];
+};
+
+/* boîte englobante des sphères et des centres d'une plage */
+struct range_stats {
+	double min[3], max[3];
+	double cmin[3], cmax[3];
+};
+
+static inline void box_empty(double *min, double *max)
+{
+	for (int a = 0; a < 3; a++) {
+		min[a] = INFINITY;
+		max[a] = -INFINITY;
+	}
+}
+
+static inline void box_grow(double *min, double *max, const double *bmin, const double *bmax)
+{
+	for (int a = 0; a < 3; a++) {
+		if (bmin[a] < min[a])
+			min[a] = bmin[a];
+		if (bmax[a] > max[a])
+			max[a] = bmax[a];
+	}
+}
+
+static inline double box_area(const double *min, const double *max)
+{
+	double e[3];
+	for (int a = 0; a < 3; a++)
+		e[a] = (max[a] > min[a]) ? max[a] - min[a] : 0;
+	return 2 * (e[0] * e[1] + e[1] * e[2] + e[2] * e[0]);
+}
+
+static inline void prim_box(const struct build *ctx, int p, double *min, double *max)
+{
+	double c[3] = {ctx->cx[p], ctx->cy[p], ctx->cz[p]};
+	for (int a = 0; a < 3; a++) {
+		min[a] = c[a] - ctx->radius[p];
+		max[a] = c[a] + ctx->radius[p];
+	}
+}
+
+static inline double prim_centre(const struct build *ctx, int p, int axis)
+{
+	return (axis == 0) ? ctx->cx[p] : ((axis == 1) ? ctx->cy[p] : ctx->cz[p]);
+}
+
+/* case de la sphère p le long de axis (même formule pour le binning et la partition) */
+static inline int prim_bin(const struct build *ctx, int p, int axis, const double *cmin, const double *scale)
+{
+	int b = (prim_centre(ctx, p, axis) - cmin[axis]) * scale[axis];
+	return (b >= NB_BINS) ? NB_BINS - 1 : b;
+}
+
+/* découpe [begin, end) en morceaux traités par des tâches distinctes si la plage est grande */
+static inline int nb_chunks(int begin, int end)
+{
+	return (end - begin >= PAR_MIN) ? NB_CHUNKS : 1;
+}
+
+static inline int chunk_begin(int begin, int end, int chunks, int c)
+{
+	return begin + (long) (end - begin) * c / chunks;
+}
+
+static void range_stats_chunk(const struct build *ctx, int begin, int end, struct range_stats *s)
+{
+	box_empty(s->min, s->max);
+	box_empty(s->cmin, s->cmax);
+	for (int k = begin; k < end; k++) {
+		int p = ctx->prim[k];
+		double bmin[3], bmax[3];
+		double c[3] = {ctx->cx[p], ctx->cy[p], ctx->cz[p]};
+		prim_box(ctx, p, bmin, bmax);
+		box_grow(s->min, s->max, bmin, bmax);
+		box_grow(s->cmin, s->cmax, c, c);
+	}
+}
+
+static void range_stats(const struct build *ctx, int begin, int end, struct range_stats *s)
+{
+	int chunks = nb_chunks(begin, end);
+	struct range_stats part[NB_CHUNKS];
+	#pragma omp taskloop if (chunks > 1) shared(part)
+	for (int c = 0; c < chunks; c++)
+		range_stats_chunk(ctx, chunk_begin(begin, end, chunks, c), chunk_begin(begin, end, chunks, c + 1), &part[c]);
+	*s = part[0];
+	for (int c = 1; c < chunks; c++) {
+		box_grow(s->min, s->max, part[c].min, part[c].max);
+		box_grow(s->cmin, s->cmax, part[c].cmin, part[c].cmax);
+	}
+}
+
+static void bins_chunk(const struct build *ctx, int begin, int end, const double *cmin, const double *scale,
+		struct bin bins[3][NB_BINS])
+{
+	for (int axis = 0; axis < 3; axis++)
+		for (int b = 0; b < NB_BINS; b++) {
+			bins[axis][b].count = 0;
+			box_empty(bins[axis][b].min, bins[axis][b].max);
+		}
+	for (int k = begin; k < end; k++) {
+		int p = ctx->prim[k];
+		double bmin[3], bmax[3];
+		prim_box(ctx, p, bmin, bmax);
+		for (int axis = 0; axis < 3; axis++) {
+			if (scale[axis] == 0)
+				continue;
+			struct bin *bin = &bins[axis][prim_bin(ctx, p, axis, cmin, scale)];
+			bin->count++;
+			box_grow(bin->min, bin->max, bmin, bmax);
+		}
+	}
+}
+
+/* répartit les sphères de [begin, end) dans les cases des trois axes */
+static void fill_bins(const struct build *ctx, int begin, int end, const double *cmin, const double *scale,
+		struct bin bins[3][NB_BINS])
+{
+	int chunks = nb_chunks(begin, end);
+	if (chunks == 1) {
+		bins_chunk(ctx, begin, end, cmin, scale, bins);
+		return;
+	}
+	struct bin (*part)[3][NB_BINS] = malloc(chunks * sizeof(*part));
+	if (part == NULL) {
+		perror("Impossible d'allouer la BVH");
+		exit(1);
+	}
+	#pragma omp taskloop
+	for (int c = 0; c < chunks; c++)
+		bins_chunk(ctx, chunk_begin(begin, end, chunks, c), chunk_begin(begin, end, chunks, c + 1), cmin, scale, part[c]);
+	/* fusion dans l'ordre des morceaux : l'arbre ne dépend pas du nombre de threads */
+	for (int axis = 0; axis < 3; axis++)
+		for (int b = 0; b < NB_BINS; b++) {
+			bins[axis][b] = part[0][axis][b];
+			for (int c = 1; c < chunks; c++) {
+				bins[axis][b].count += part[c][axis][b].count;
+				box_grow(bins[axis][b].min, bins[axis][b].max, part[c][axis][b].min, part[c][axis][b].max);
+			}
+		}
+	free(part);
+}
+
+static int new_node(struct build *ctx)
+{
+	int node;
+	#pragma omp atomic capture
+	node = ctx->nb_nodes++;
+	return node;
+}
+
+/* construit le sous-arbre des sphères prim[begin..end-1], dont la racine est au niveau
+   niveau (1 pour la racine de l'arbre) ; renvoie l'indice (provisoire) de sa racine */
+static int build_node(struct build *ctx, int begin, int end, int niveau)
+{
+	int node = new_node(ctx);
+	int count = end - begin;
+	struct range_stats s;
+	range_stats(ctx, begin, end, &s);
+	struct tmp_node *nd = &ctx->nodes[node];
+	memcpy(nd->min, s.min, sizeof(s.min));
+	memcpy(nd->max, s.max, sizeof(s.max));
+	nd->first = begin;
+	nd->count = count;
+	if (count <= LEAF_MIN || niveau == BVH_PROFONDEUR_MAX)
+		return node;    /* à la profondeur maximale, une feuille quelle que soit sa taille */
+
+	/* meilleur découpage binné, sur les trois axes */
+	double scale[3];
+	for (int axis = 0; axis < 3; axis++) {
+		double extent = s.cmax[axis] - s.cmin[axis];
+		scale[axis] = (extent > 0) ? NB_BINS / extent : 0;
+	}
+	struct bin bins[3][NB_BINS];
+	fill_bins(ctx, begin, end, s.cmin, scale, bins);
+	double best_cost = INFINITY;
+	int best_axis = -1, best_split = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		if (scale[axis] == 0)
+			continue;
+		/* balayage de droite à gauche puis de gauche à droite */
+		double right_area[NB_BINS];
+		int right_count[NB_BINS];
+		double rmin[3], rmax[3];
+		box_empty(rmin, rmax);
+		int rc = 0;
+		for (int b = NB_BINS - 1; b > 0; b--) {
+			box_grow(rmin, rmax, bins[axis][b].min, bins[axis][b].max);
+			rc += bins[axis][b].count;
+			right_area[b] = box_area(rmin, rmax);
+			right_count[b] = rc;
+		}
+		double lmin[3], lmax[3];
+		box_empty(lmin, lmax);
+		int lc = 0;
+		for (int b = 0; b < NB_BINS - 1; b++) {
+			box_grow(lmin, lmax, bins[axis][b].min, bins[axis][b].max);
+			lc += bins[axis][b].count;
+			if (lc == 0 || right_count[b + 1] == 0)
+				continue;
+			double cost = lc * box_area(lmin, lmax) + right_count[b + 1] * right_area[b + 1];
+			if (cost < best_cost) {
+				best_cost = cost;
+				best_axis = axis;
+				best_split = b + 1;
+			}
+		}
+	}
+
+	int mid;
+	if (best_axis < 0) {
+		/* centres confondus : on coupe au milieu pour borner la taille des feuilles */
+		if (count <= LEAF_MAX)
+			return node;
+		mid = begin + count / 2;
+	} else {
+		double area = box_area(s.min, s.max);
+		double split_cost = TRAVERSAL_COST + best_cost / area;
+		if (split_cost >= count && count <= LEAF_MAX)
+			return node;
+		/* partition : les sphères des cases < best_split à gauche */
+		int i = begin, j = end - 1;
+		while (i <= j) {
+			if (prim_bin(ctx, ctx->prim[i], best_axis, s.cmin, scale) < best_split) {
+				i++;
+			} else {
+				int tmp = ctx->prim[i];
+				ctx->prim[i] = ctx->prim[j];
+				ctx->prim[j--] = tmp;
+			}
+		}
+		mid = i;
+	}
+
+	/* les deux sous-arbres portent sur des plages disjointes de prim[] */
+	int left, right;
+	#pragma omp task shared(left) if (count >= PAR_MIN)
+	left = build_node(ctx, begin, mid, niveau + 1);
+	right = build_node(ctx, mid, end, niveau + 1);
+	#pragma omp taskwait
+	nd = &ctx->nodes[node];
+	nd->left = left;
+	nd->right = right;
+	nd->count = 0;
+	return node;
+}
+
+/* recopie l'arbre provisoire en profondeur d'abord (fils gauche = noeud suivant) ;
+   niveau : noeuds de la racine à celui-ci compris, dont on garde le maximum */
+static void flatten(const struct build *ctx, int tmp, int niveau, struct bvh_node *out, int *nb, int *profondeur)
+{
+	const struct tmp_node *nd = &ctx->nodes[tmp];
+	int k = (*nb)++;
+	if (niveau > *profondeur)
+		*profondeur = niveau;
+	memcpy(out[k].min, nd->min, sizeof(nd->min));
+	memcpy(out[k].max, nd->max, sizeof(nd->max));
+	out[k].count = nd->count;
+	out[k].first = nd->first;
+	if (nd->count == 0) {
+		flatten(ctx, nd->left, niveau + 1, out, nb, profondeur);
+		out[k].first = *nb;
+		flatten(ctx, nd->right, niveau + 1, out, nb, profondeur);
+	}
+}
+
+/* place les tableaux de b dans le bloc base ; renvoie la taille du bloc */
+static size_t bvh_layout(struct bvh *b, void *base)
+{
+	size_t off_prim = b->nb_nodes * sizeof(struct bvh_node);
+	size_t off_soa = (off_prim + b->n * sizeof(int) + 63) / 64 * 64;
+	b->bloc = base;
+	b->nodes = base;
+	b->prim = (int *) ((char *) base + off_prim);
+	b->px = (double *) ((char *) base + off_soa);
+	b->py = b->px + b->n;
+	b->pz = b->py + b->n;
+	b->r2 = b->pz + b->n;
+	b->taille = off_soa + 4 * (size_t) b->n * sizeof(double);
+	return b->taille;
+}
+
+void bvh_build(struct bvh *b, const double *px, const double *py, const double *pz, const double *radius, int n)
+{
+	struct build ctx = {px, py, pz, radius, malloc(n * sizeof(int)), malloc((2 * n + 1) * sizeof(struct tmp_node)), 0};
+	if (ctx.prim == NULL || ctx.nodes == NULL) {
+		perror("Impossible d'allouer la BVH");
+		exit(1);
+	}
+	for (int k = 0; k < n; k++)
+		ctx.prim[k] = k;
+	if (n > 0) {
+		#pragma omp parallel if (n >= PAR_MIN)
+		#pragma omp single
+		build_node(&ctx, 0, n, 1);
+	}
+
+	/* un seul bloc : noeuds, permutation, puis sphères dans l'ordre des feuilles (alignées sur 64 octets) */
+	b->n = n;
+	b->nb_nodes = ctx.nb_nodes;
+	b->mapping = NULL;
+	void *bloc;
+	if (posix_memalign(&bloc, 64, bvh_layout(b, NULL)) != 0) {
+		perror("Impossible d'allouer la BVH");
+		exit(1);
+	}
+	bvh_layout(b, bloc);
+	memset(bloc, 0, b->taille);     /* octets de bourrage compris : le cache est reproductible */
+	int nb = 0;
+	b->profondeur = 0;
+	if (n > 0)
+		flatten(&ctx, 0, 1, b->nodes, &nb, &b->profondeur);
+	memcpy(b->prim, ctx.prim, n * sizeof(int));
+	for (int k = 0; k < n; k++) {
+		int p = ctx.prim[k];
+		b->px[k] = px[p];
+		b->py[k] = py[p];
+		b->pz[k] = pz[p];
+		b->r2[k] = radius[p] * radius[p];
+	}
+	free(ctx.prim);
+	free(ctx.nodes);
+}
+
+/********************************** cache sur disque ******************************************/
+
+/* en-tête du fichier cache ; le bloc de la BVH suit, tel quel, à l'offset CACHE_HEADER */
+#define CACHE_MAGIC "BVHCACHE"
+#define CACHE_VERSION 2
+#define CACHE_HEADER 4096           /* une page : le bloc projeté reste aligné */
+
+struct cache_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t node_size;             /* sizeof(struct bvh_node) : refuse un autre ABI */
+	uint64_t hash;
+	int32_t n, nb_nodes, profondeur, bourrage;  /* bourrage explicite : l'en-tête est reproductible */
+	uint64_t taille;
+};
+
+uint64_t bvh_hash(const double *px, const double *py, const double *pz, const double *radius, int n)
+{
+	/* FNV-1a sur des mots de 64 bits */
+	uint64_t h = 0xcbf29ce484222325ull ^ (uint64_t) n;
+	const double *tab[4] = {px, py, pz, radius};
+	for (int t = 0; t < 4; t++)
+		for (int i = 0; i < n; i++) {
+			uint64_t w;
+			memcpy(&w, &tab[t][i], sizeof(w));
+			h = (h ^ w) * 0x100000001b3ull;
+		}
+	return h;
+}
+
+/* un fichier du disque n'est pas une BVH qu'on a construite : on vérifie les fils,
+   les plages de sphères et la profondeur annoncée avant de s'en servir */
+static bool bvh_valide(const struct bvh *b)
+{
+	if (b->nb_nodes == 0)
+		return true;
+	if (b->profondeur > BVH_PROFONDEUR_MAX)
+		return false;
+	int noeud[BVH_PROFONDEUR_MAX + 1], niveau[BVH_PROFONDEUR_MAX + 1];   /* profondeur <= BVH_PROFONDEUR_MAX */
+	int top = 0, visites = 0;
+	noeud[top] = 0;
+	niveau[top++] = 1;
+	while (top > 0) {
+		top--;
+		const struct bvh_node *nd = &b->nodes[noeud[top]];
+		int k = noeud[top], l = niveau[top];
+		if (l > b->profondeur || ++visites > b->nb_nodes)
+			return false;
+		if (nd->count > 0) {
+			if (nd->first < 0 || nd->first > b->n - nd->count)
+				return false;
+			continue;
+		}
+		if (nd->count < 0 || nd->first <= k + 1 || nd->first >= b->nb_nodes || top + 2 > b->profondeur + 1)
+			return false;
+		noeud[top] = nd->first;
+		niveau[top++] = l + 1;
+		noeud[top] = k + 1;
+		niveau[top++] = l + 1;
+	}
+	return visites == b->nb_nodes;
+}
+
+bool bvh_load(struct bvh *b, const char *path, uint64_t hash, int n)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct cache_header hd;
+	struct stat st;
+	bool ok = fstat(fd, &st) == 0 && read(fd, &hd, sizeof(hd)) == sizeof(hd)
+		&& memcmp(hd.magic, CACHE_MAGIC, 8) == 0 && hd.version == CACHE_VERSION
+		&& hd.node_size == sizeof(struct bvh_node) && hd.hash == hash && hd.n == n
+		&& (uint64_t) st.st_size == CACHE_HEADER + hd.taille;
+
+	/* un arbre binaire à feuilles non vides a au plus 2n - 1 noeuds ; la taille du
+	   bloc doit être celle que donnent n et nb_nodes */
+	struct bvh lu = {.n = n, .nb_nodes = hd.nb_nodes, .profondeur = hd.profondeur};
+	ok = ok && (hd.nb_nodes > 0) == (n > 0) && (int64_t) hd.nb_nodes <= ((n > 0) ? 2 * (int64_t) n - 1 : 0)
+		&& hd.profondeur >= (hd.nb_nodes > 0) && hd.profondeur <= hd.nb_nodes && hd.profondeur <= BVH_PROFONDEUR_MAX
+		&& bvh_layout(&lu, NULL) == hd.taille;
+	void *mapping = MAP_FAILED;
+	if (ok)
+		mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return false;
+	bvh_layout(&lu, (char *) mapping + CACHE_HEADER);
+	if (!bvh_valide(&lu)) {
+		munmap(mapping, st.st_size);
+		return false;
+	}
+	*b = lu;
+	b->mapping = mapping;
+	return true;
+}
+
+bool bvh_save(const struct bvh *b, const char *path, uint64_t hash)
+{
+	/* écrit dans un fichier temporaire puis renomme : un lecteur ne voit jamais un fichier partiel */
+	char tmp[PATH_MAX];
+	if (snprintf(tmp, sizeof(tmp), "%s.%d", path, (int) getpid()) >= (int) sizeof(tmp))
+		return false;
+	FILE *f = fopen(tmp, "w");
+	if (f == NULL)
+		return false;
+	char page[CACHE_HEADER] = {0};
+	struct cache_header hd = {CACHE_MAGIC, CACHE_VERSION, sizeof(struct bvh_node), hash, b->n, b->nb_nodes, b->profondeur, 0, b->taille};
+	memcpy(page, &hd, sizeof(hd));
+	bool ok = fwrite(page, CACHE_HEADER, 1, f) == 1 && fwrite(b->bloc, b->taille, 1, f) == 1;
+	ok = (fclose(f) == 0) && ok;
+	if (ok)
+		ok = rename(tmp, path) == 0;
+	if (!ok)
+		unlink(tmp);
+	return ok;
+}
+
+void bvh_build_cached(struct bvh *b, const char *dir, const double *px, const double *py, const double *pz,
+		const double *radius, int n)
+{
+	uint64_t hash = bvh_hash(px, py, pz, radius, n);
+	char path[PATH_MAX], lock[PATH_MAX + 8];
+	if (snprintf(path, sizeof(path), "%s/bvh-%016llx.bin", dir, (unsigned long long) hash) >= (int) sizeof(path)) {
+		bvh_build(b, px, py, pz, radius, n);
+		return;
+	}
+	snprintf(lock, sizeof(lock), "%s.lock", path);
+	if (bvh_load(b, path, hash, n))
+		return;
+
+	/* un seul processus par machine construit : les autres attendent le verrou puis projettent le fichier */
+	mkdir(dir, S_IRWXU);
+	int fd = open(lock, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if (fd >= 0)
+		flock(fd, LOCK_EX);
+	if (!bvh_load(b, path, hash, n)) {
+		bvh_build(b, px, py, pz, radius, n);
+		if (!bvh_save(b, path, hash))
+			fprintf(stderr, "BVH : impossible d'écrire le cache %s\n", path);
+	}
+	if (fd >= 0)
+		close(fd);      /* libère le verrou */
+}
+
+void bvh_free(struct bvh *b)
+{
+	if (b->mapping != NULL)
+		munmap(b->mapping, CACHE_HEADER + b->taille);
+	else
+		free(b->bloc);
+	memset(b, 0, sizeof(*b));
+}
+
+/* test rayon / boîte (méthode des dalles) ; renvoie la distance d'entrée, ou INF */
+static inline double box_hit(const struct bvh_node *nd, const double *o, const double *inv, double tmax)
+{
+	double t0 = 0, t1 = tmax;
+	for (int a = 0; a < 3; a++) {
+		double ta = (nd->min[a] - o[a]) * inv[a];
+		double tb = (nd->max[a] - o[a]) * inv[a];
+		/* sans branchement (minsd/maxsd) : l'ordre de ta et tb est imprévisible ;
+		   les NaN de 0 * inf sont ignorés par ces comparaisons */
+		double lo = (ta < tb) ? ta : tb;
+		double hi = (ta < tb) ? tb : ta;
+		t0 = (lo > t0) ? lo : t0;
+		t1 = (hi < t1) ? hi : t1;
+	}
+	return (t0 <= t1) ? t0 : INF;
+}
+
+bool bvh_intersect(const struct bvh *b, const double *ray_origin, const double *ray_direction, double *t, int *id)
+{
+	double inv[3];
+	for (int a = 0; a < 3; a++)
+		inv[a] = 1 / ray_direction[a];
+	double best = INF;
+	int best_id = -1;
+	/* au plus un noeud empilé par niveau au-dessus des feuilles : la pile ne déborde jamais
+	   (profondeur <= BVH_PROFONDEUR_MAX, à la construction comme au chargement) */
+	int stack[BVH_PILE_MAX];
+	int top = 0;
+	int node = 0;
+	*t = INF;
+	if (b->nb_nodes == 0 || box_hit(&b->nodes[0], ray_origin, inv, best) == INF)
+		return false;
+
+	for (;;) {
+		const struct bvh_node *nd = &b->nodes[node];
+		if (nd->count > 0) {
+			for (int k = nd->first; k < nd->first + nd->count; k++) {
+				double opx = b->px[k] - ray_origin[0];
+				double opy = b->py[k] - ray_origin[1];
+				double opz = b->pz[k] - ray_origin[2];
+				double bb = opx * ray_direction[0] + opy * ray_direction[1] + opz * ray_direction[2];
+				double det = bb * bb - (opx * opx + opy * opy + opz * opz) + b->r2[k];
+				if (det < 0)
+					continue;
+				det = sqrt(det);
+				double d = (bb - det > EPS) ? bb - det : ((bb + det > EPS) ? bb + det : INF);
+				if (d < best || (d == best && d < INF && b->prim[k] < best_id)) {
+					best = d;
+					best_id = b->prim[k];
+				}
+			}
+		} else {
+			/* visite d'abord le fils le plus proche, empile l'autre */
+			int left = node + 1, right = nd->first;
+			double tl = box_hit(&b->nodes[left], ray_origin, inv, best);
+			double tr = box_hit(&b->nodes[right], ray_origin, inv, best);
+			if (tl > tr) {
+				int tmp = left;
+				left = right;
+				right = tmp;
+				double tt = tl;
+				tl = tr;
+				tr = tt;
+			}
+			if (tl < INF) {
+				if (tr < INF)
+					stack[top++] = right;
+				node = left;
+				continue;
+			}
+		}
+		/* dépile le prochain noeud encore susceptible de contenir une intersection plus proche */
+		do {
+			if (top == 0) {
+				*t = best;
+				if (best < INF)
+					*id = best_id;
+				return best < INF;
+			}
+			node = stack[--top];
+		} while (box_hit(&b->nodes[node], ray_origin, inv, best) == INF);
+	}
+}
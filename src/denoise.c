@@ -0,0 +1,244 @@
+/* Débruitage par ondelettes à trous guidées (voir denoise.h). */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "blas.h"
+#include "denoise.h"
+
+#define REBONDS_SPECULAIRES 8   /* miroirs et verre traversés pour trouver le premier point diffus */
+#define ALBEDO_MIN 0.02f        /* ajouté à l'albédo pour la démodulation (canaux noirs) */
+
+/******************************* tampons de guidage *************************************/
+
+/* suit le rayon à travers les surfaces spéculaires jusqu'au premier point diffus (ou
+   émissif) : normale (orientée vers le rayon), albédo cumulé, longueur du chemin */
+static void premier_diffus(const struct scene *sc, const double *ray_origin, const double *ray_direction,
+		double *normale, double *albedo, double *longueur)
+{
+	double origin[3], direction[3];
+	copy(ray_origin, origin);
+	copy(ray_direction, direction);
+	albedo[0] = albedo[1] = albedo[2] = 1;
+	zero(normale);
+	*longueur = 0;
+	for (int k = 0; k < REBONDS_SPECULAIRES; k++) {
+		double t;
+		int id;
+		if (!render_intersect(sc, origin, direction, &t, &id))
+			return;
+		const struct Sphere *obj = &sc->spheres[id];
+		*longueur += t;
+		double x[3], n[3], nl[3];
+		copy(origin, x);
+		axpy(t, direction, x);
+		copy(x, n);
+		axpy(-1, obj->position, n);
+		normalize(n);
+		copy(n, nl);
+		if (dot(n, direction) > 0)
+			scal(-1, nl);
+		copy(nl, normale);
+		if (obj->emission[0] > 0 || obj->emission[1] > 0 || obj->emission[2] > 0)
+			return;             /* source de lumière : albédo 1, pas de démodulation */
+		double f[3];
+		mul(albedo, obj->color, f);
+		copy(f, albedo);
+		if (obj->refl == DIFF)
+			return;
+
+		/* miroir, ou verre : on suit le rayon réfracté (réfléchi si réflexion totale) */
+		double d[3];
+		copy(direction, d);
+		axpy(-2 * dot(n, direction), n, d);
+		if (obj->refl == REFR) {
+			bool into = dot(n, nl) > 0;
+			double nnt = into ? 1 / 1.5 : 1.5;
+			double ddn = dot(direction, nl);
+			double cos2t = 1 - nnt * nnt * (1 - ddn * ddn);
+			if (cos2t >= 0) {
+				zero(d);
+				axpy(nnt, direction, d);
+				axpy(-(into ? 1 : -1) * (ddn * nnt + sqrt(cos2t)), n, d);
+			}
+		}
+		copy(x, origin);
+		copy(d, direction);
+	}
+}
+
+void gbuffer_init(struct gbuffer *gb, const struct scene *sc, const struct camera *cam, bool haut_en_bas)
+{
+	int w = cam->w, h = cam->h;
+	gb->w = w;
+	gb->h = h;
+	gb->normale = malloc(3 * w * h * sizeof(float));
+	gb->albedo = malloc(3 * w * h * sizeof(float));
+	gb->profondeur = malloc(w * h * sizeof(float));
+	if (gb->normale == NULL || gb->albedo == NULL || gb->profondeur == NULL) {
+		perror("Impossible d'allouer les tampons de guidage");
+		exit(1);
+	}
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < h; i++)
+		for (int j = 0; j < w; j++) {
+			/* moyenne des rayons qui passent au centre des 4 sous-pixels */
+			double normale[3] = {0, 0, 0}, albedo[3] = {0, 0, 0}, longueur = 0;
+			for (int sub = 0; sub < 4; sub++) {
+				const double centre[2] = {.5, .5};
+				double o[3], d[3], n[3], a[3], l;
+				camera_ray(cam, i, j, sub >> 1, sub & 1, centre, o, d);
+				premier_diffus(sc, o, d, n, a, &l);
+				axpy(1, n, normale);
+				axpy(.25, a, albedo);
+				longueur += l / 4;
+			}
+			if (nrm2(normale) > 0)
+				normalize(normale);
+			int p = (haut_en_bas ? h - 1 - i : i) * w + j;
+			for (int c = 0; c < 3; c++) {
+				gb->normale[3 * p + c] = normale[c];
+				gb->albedo[3 * p + c] = albedo[c];
+			}
+			gb->profondeur[p] = longueur;
+		}
+}
+
+void gbuffer_free(struct gbuffer *gb)
+{
+	free(gb->normale);
+	free(gb->albedo);
+	free(gb->profondeur);
+	memset(gb, 0, sizeof(*gb));
+}
+
+/********************************** filtre ***********************************************/
+
+void denoise_defaut(struct denoise *dn)
+{
+	dn->sigma_couleur = 2;
+	dn->sigma_normale = 0.5f;
+	dn->sigma_albedo = 0.2f;
+	dn->sigma_profondeur = 0.1f;
+}
+
+/* noyau B3-spline 1D (le noyau 5 x 5 est son produit) */
+static const float noyau[5] = {1.f / 16, 1.f / 4, 3.f / 8, 1.f / 4, 1.f / 16};
+
+/* rectangle [x0, x1) x [y0, y1) */
+struct zone {
+	int x0, y0, x1, y1;
+};
+
+/* z agrandie de m pixels de chaque côté, sans sortir de l'image */
+static struct zone agrandie(struct zone z, int m, int w, int h)
+{
+	struct zone r = {z.x0 - m, z.y0 - m, z.x1 + m, z.y1 + m};
+	r.x0 = (r.x0 < 0) ? 0 : r.x0;
+	r.y0 = (r.y0 < 0) ? 0 : r.y0;
+	r.x1 = (r.x1 > w) ? w : r.x1;
+	r.y1 = (r.y1 > h) ? h : r.y1;
+	return r;
+}
+
+static inline float carre(float x)
+{
+	return x * x;
+}
+
+void denoise_tuile(const struct denoise *dn, const struct gbuffer *gb, const double *image,
+		int x0, int y0, int x1, int y1, double *out)
+{
+	int w = gb->w, h = gb->h;
+	struct zone tuile = {x0, y0, x1, y1};
+	/* tampons locaux sur la tuile et sa marge ; (x, y) de l'image est en (x - l.x0, y - l.y0) */
+	struct zone l = agrandie(tuile, DENOISE_MARGE, w, h);
+	int lw = l.x1 - l.x0, lh = l.y1 - l.y0;
+	float *cur = malloc(3 * lw * lh * sizeof(float));
+	float *suiv = malloc(3 * lw * lh * sizeof(float));
+	if (cur == NULL || suiv == NULL) {
+		perror("Impossible d'allouer les tampons du débruitage");
+		exit(1);
+	}
+
+	/* éclairement : couleur / albédo */
+	for (int y = l.y0; y < l.y1; y++)
+		for (int x = l.x0; x < l.x1; x++) {
+			int p = y * w + x, q = (y - l.y0) * lw + (x - l.x0);
+			for (int c = 0; c < 3; c++)
+				cur[3 * q + c] = image[3 * p + c] / (gb->albedo[3 * p + c] + ALBEDO_MIN);
+		}
+
+	const float *N = gb->normale, *A = gb->albedo, *Z = gb->profondeur;
+	float sigma_c = dn->sigma_couleur;
+	float in_n = 1 / carre(dn->sigma_normale), in_a = 1 / carre(dn->sigma_albedo);
+	float in_z = 1 / carre(dn->sigma_profondeur);
+	for (int passe = 0; passe < DENOISE_PASSES; passe++, sigma_c /= 2) {
+		int pas = 1 << passe;
+		/* marge encore nécessaire aux passes suivantes */
+		struct zone z = agrandie(tuile, 2 * ((1 << DENOISE_PASSES) - (2 << passe)), w, h);
+		float in_c = 1 / carre(sigma_c);
+		for (int y = z.y0; y < z.y1; y++)
+			for (int x = z.x0; x < z.x1; x++) {
+				int p = y * w + x, q = (y - l.y0) * lw + (x - l.x0);
+				const float *cp = cur + 3 * q;
+				float zp = fmaxf(Z[p], 1e-3f);
+				float somme[3] = {0, 0, 0}, poids = 0;
+				for (int dy = -2; dy <= 2; dy++) {
+					int yy = y + dy * pas;
+					if (yy < 0 || yy >= h)
+						continue;
+					for (int dx = -2; dx <= 2; dx++) {
+						int xx = x + dx * pas;
+						if (xx < 0 || xx >= w)
+							continue;
+						int pv = yy * w + xx, qv = (yy - l.y0) * lw + (xx - l.x0);
+						const float *cq = cur + 3 * qv;
+						float e = in_c * (carre(cp[0] - cq[0]) + carre(cp[1] - cq[1]) + carre(cp[2] - cq[2]))
+							+ in_n * (carre(N[3 * p] - N[3 * pv]) + carre(N[3 * p + 1] - N[3 * pv + 1])
+								+ carre(N[3 * p + 2] - N[3 * pv + 2]))
+							+ in_a * (carre(A[3 * p] - A[3 * pv]) + carre(A[3 * p + 1] - A[3 * pv + 1])
+								+ carre(A[3 * p + 2] - A[3 * pv + 2]))
+							+ in_z * carre((Z[pv] - Z[p]) / zp);
+						float wq = noyau[dx + 2] * noyau[dy + 2] * expf(-e);
+						somme[0] += wq * cq[0];
+						somme[1] += wq * cq[1];
+						somme[2] += wq * cq[2];
+						poids += wq;
+					}
+				}
+				/* poids > 0 : le pixel lui-même a un poids noyau[2]² */
+				for (int c = 0; c < 3; c++)
+					suiv[3 * q + c] = somme[c] / poids;
+			}
+		float *t = cur;
+		cur = suiv;
+		suiv = t;
+	}
+
+	/* remodulation par l'albédo */
+	for (int y = y0; y < y1; y++)
+		for (int x = x0; x < x1; x++) {
+			int p = y * w + x, q = (y - l.y0) * lw + (x - l.x0);
+			for (int c = 0; c < 3; c++)
+				out[3 * p + c] = cur[3 * q + c] * (gb->albedo[3 * p + c] + ALBEDO_MIN);
+			clamp(out + 3 * p);
+		}
+	free(cur);
+	free(suiv);
+}
+
+void denoise_image(const struct denoise *dn, const struct gbuffer *gb, const double *image, double *out)
+{
+	int tx = (gb->w + DENOISE_TUILE - 1) / DENOISE_TUILE;
+	int ty = (gb->h + DENOISE_TUILE - 1) / DENOISE_TUILE;
+	#pragma omp parallel for schedule(dynamic)
+	for (int t = 0; t < tx * ty; t++) {
+		int x0 = (t % tx) * DENOISE_TUILE, y0 = (t / tx) * DENOISE_TUILE;
+		int x1 = (x0 + DENOISE_TUILE < gb->w) ? x0 + DENOISE_TUILE : gb->w;
+		int y1 = (y0 + DENOISE_TUILE < gb->h) ? y0 + DENOISE_TUILE : gb->h;
+		denoise_tuile(dn, gb, image, x0, y0, x1, y1, out);
+	}
+}
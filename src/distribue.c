@@ -0,0 +1,147 @@
+/* Pilote MPI commun : table des stratégies, rendu et rassemblement (voir distribue.h). */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "distribue.h"
+
+enum { TAG_PLAGES = 40, TAG_PIXELS };
+
+static const struct strategie strategies[] = {
+	{"static", strategie_statique},
+	{"rows", strategie_lignes},
+	{"nodes", strategie_noeuds},
+	{"ring", strategie_anneau},
+	{"random", strategie_hasard},
+	{"hybrid", strategie_hybride},
+};
+
+const struct strategie *strategie_cherche(const char *nom)
+{
+	for (size_t k = 0; k < sizeof(strategies) / sizeof(strategies[0]); k++)
+		if (strcmp(nom, strategies[k].nom) == 0)
+			return &strategies[k];
+	return NULL;
+}
+
+/* au moins n éléments de taille octets dans *t, qui en a *max */
+static void agrandit(void *t, long *max, long n, size_t taille)
+{
+	if (n <= *max)
+		return;
+	long m = (2 * *max > n) ? 2 * *max : n;
+	void *nouveau = realloc(*(void **) t, m * taille);
+	if (nouveau == NULL) {
+		perror("Impossible d'agrandir le relevé");
+		exit(1);
+	}
+	*(void **) t = nouveau;
+	*max = m;
+}
+
+double *distribue_place(struct travail *tr, struct releve *r, long indice, long nb)
+{
+	if (tr->image != NULL)
+		return tr->image + 3 * indice;
+	if (r->nb_plages > 0 && r->plages[2 * r->nb_plages - 2] + r->plages[2 * r->nb_plages - 1] == indice)
+		r->plages[2 * r->nb_plages - 1] += nb;  /* à la suite de la plage précédente */
+	else {
+		agrandit(&r->plages, &r->max_plages, 2 * (r->nb_plages + 1), sizeof(long));
+		r->plages[2 * r->nb_plages] = indice;
+		r->plages[2 * r->nb_plages + 1] = nb;
+		r->nb_plages++;
+	}
+	agrandit(&r->pixels, &r->max_pixels, 3 * (r->nb_pixels + nb), sizeof(double));
+	double *p = r->pixels + 3 * r->nb_pixels;
+	r->nb_pixels += nb;
+	return p;
+}
+
+void releve_concatene(struct releve *dst, struct releve *src)
+{
+	agrandit(&dst->plages, &dst->max_plages, 2 * (dst->nb_plages + src->nb_plages), sizeof(long));
+	agrandit(&dst->pixels, &dst->max_pixels, 3 * (dst->nb_pixels + src->nb_pixels), sizeof(double));
+	memcpy(dst->plages + 2 * dst->nb_plages, src->plages, 2 * src->nb_plages * sizeof(long));
+	memcpy(dst->pixels + 3 * dst->nb_pixels, src->pixels, 3 * src->nb_pixels * sizeof(double));
+	dst->nb_plages += src->nb_plages;
+	dst->nb_pixels += src->nb_pixels;
+	releve_free(src);
+}
+
+void releve_free(struct releve *r)
+{
+	free(r->plages);
+	free(r->pixels);
+	*r = (struct releve) {0};
+}
+
+void distribue_pixel(struct travail *tr, long p)
+{
+	int i, j;
+	tuiles_pixel(tr->tp, p, &i, &j);
+	double *pixel = distribue_place(tr, &tr->releve, (long) i * tr->cam->w + j, 1);
+	double debut = MPI_Wtime();
+	tr->rayons += render_pixel(tr->sc, tr->cam, i, j, tr->samples, pixel);
+	tr->dernier = MPI_Wtime();
+	tr->calcul += tr->dernier - debut;
+	tr->pixels++;
+}
+
+void distribue_ligne(struct travail *tr, int i, int j0, int j1, double *pixels)
+{
+	double debut = MPI_Wtime();
+	for (int j = j0; j < j1; j++)
+		tr->rayons += render_pixel(tr->sc, tr->cam, i, j, tr->samples, pixels + 3 * (j - j0));
+	tr->dernier = MPI_Wtime();
+	tr->calcul += tr->dernier - debut;
+	tr->pixels += j1 - j0;
+}
+
+/* chaque processus envoie ses plages puis ses pixels ; le rang 0 les prend dans
+   l'ordre d'arrivée, avec un seul tampon, de la taille du plus gros relevé. Sur un
+   communicateur à part : un processus qui a fini ne doit pas tomber dans la
+   sonde (MPI_ANY_TAG) d'une stratégie qui tourne encore ailleurs. */
+void distribue_rassemble(struct travail *tr)
+{
+	MPI_Comm comm;
+	MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+	if (tr->rang != 0) {
+		struct releve *r = &tr->releve;
+		MPI_Send(r->plages, 2 * r->nb_plages, MPI_LONG, 0, TAG_PLAGES, comm);
+		MPI_Send(r->pixels, 3 * r->nb_pixels, MPI_DOUBLE, 0, TAG_PIXELS, comm);
+		releve_free(r);
+		MPI_Comm_free(&comm);
+		return;
+	}
+	struct releve r = {0};
+	for (int k = 1; k < tr->size; k++) {
+		MPI_Status status;
+		int n;
+		MPI_Probe(MPI_ANY_SOURCE, TAG_PLAGES, comm, &status);
+		MPI_Get_count(&status, MPI_LONG, &n);
+		agrandit(&r.plages, &r.max_plages, n, sizeof(long));
+		MPI_Recv(r.plages, n, MPI_LONG, status.MPI_SOURCE, TAG_PLAGES, comm, MPI_STATUS_IGNORE);
+		r.nb_plages = n / 2;
+		r.nb_pixels = 0;
+		for (long q = 0; q < r.nb_plages; q++)
+			r.nb_pixels += r.plages[2 * q + 1];
+		agrandit(&r.pixels, &r.max_pixels, 3 * r.nb_pixels, sizeof(double));
+		MPI_Recv(r.pixels, 3 * r.nb_pixels, MPI_DOUBLE, status.MPI_SOURCE, TAG_PIXELS, comm, MPI_STATUS_IGNORE);
+		const double *p = r.pixels;
+		for (long q = 0; q < r.nb_plages; q++) {
+			memcpy(tr->image + 3 * r.plages[2 * q], p, 3 * r.plages[2 * q + 1] * sizeof(double));
+			p += 3 * r.plages[2 * q + 1];
+		}
+	}
+	releve_free(&r);
+	MPI_Comm_free(&comm);
+}
+
+/* static : le bloc [n * rang / size, n * (rang + 1) / size) des positions du parcours */
+void strategie_statique(struct travail *tr)
+{
+	long n = (long) tr->cam->w * tr->cam->h;
+	for (long p = n * tr->rang / tr->size; p < n * (tr->rang + 1) / tr->size; p++)
+		distribue_pixel(tr, p);
+	distribue_rassemble(tr);
+}
@@ -0,0 +1,242 @@
+/* Stratégie hybrid : threads OpenMP et vol de tuiles (voir distribue.h et tuiles.h).
+ *
+ * Chaque processus a un bloc de tuiles, réparti entre
+ * ses threads de calcul (un par cœur), qui volent dans les files des autres
+ * threads du nœud. Un thread de communication fait circuler les demandes
+ * de travail sur l'anneau des processus et sert celles des autres en volant
+ * la moitié des tuiles qui restent dans les files.
+ *
+ * Seul le thread de communication (le thread principal) appelle MPI : il
+ * suffit de MPI_THREAD_FUNNELED, sinon on se rabat sur ring. Il compte les
+ * tuiles du nœud qui ne sont pas encore rendues ; le nœud est passif quand il
+ * n'en reste plus, et la fin est celle de ring (Dijkstra et Safra,
+ * terminaison_* dans distribue_vol.c). Tant que le nœud est actif, le thread
+ * de communication sonde de moins en moins souvent quand rien n'arrive (au
+ * plus toutes les ATTENTE_MAX µs) ; passif, il attend le prochain message.
+ */
+#include <omp.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "distribue.h"
+#include "placement.h"
+
+enum { TAG_DEMANDE, TAG_TUILES };
+
+#define ATTENTE_MAX 1000        /* µs */
+
+struct communication {
+	struct travail *tr;
+	struct tuiles *tp;
+	struct deque *recues;           /* file du thread de communication */
+	atomic_long *restantes;         /* tuiles du nœud pas encore rendues */
+	int *message;
+	unsigned graine;
+	bool demande;                   /* une demande de ce processus est en route */
+	struct terminaison fin;
+};
+
+/* attend attente µs, puis deux fois plus la fois suivante */
+static void patiente(long *attente)
+{
+	*attente = (*attente == 0) ? 1 : (2 * *attente < ATTENTE_MAX) ? 2 * *attente : ATTENTE_MAX;
+	struct timespec t = {0, *attente * 1000};
+	nanosleep(&t, NULL);
+}
+
+static void envoie(struct communication *c, int dest, int tag, long a)
+{
+	long m[2] = {a, 0};
+	terminaison_envoie(&c->fin, m, 2, MPI_LONG, dest, tag);
+}
+
+static void traite(struct communication *c, const MPI_Status *status)
+{
+	int rang = c->tr->rang, size = c->tr->size;
+	if (status->MPI_TAG == TAG_TUILES) {
+		int count;
+		MPI_Get_count(status, MPI_INT, &count);
+		MPI_Recv(c->message, count, MPI_INT, status->MPI_SOURCE, TAG_TUILES, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		c->fin.recus++;
+		atomic_fetch_add(c->restantes, count);
+		for (int k = 0; k < count; k++)
+			deque_push(c->recues, c->message[k]);
+		c->demande = false;
+		terminaison_don_recu(&c->fin);
+		return;
+	}
+	long m[2];
+	MPI_Recv(m, 2, MPI_LONG, status->MPI_SOURCE, status->MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+	c->fin.recus++;
+	if (terminaison_recoit(&c->fin, status->MPI_TAG, m) || c->fin.arret)
+		return;
+	/* une demande (rang du demandeur) fait le tour des processus ; le premier qui a au
+	   moins 2 tuiles en réserve en vole la moitié et les envoie au demandeur */
+	int demandeur = m[0];
+	int n = tuiles_vole_moitie(c->tp, &c->graine, c->message, c->tp->nb);
+	if (n > 0) {
+		atomic_fetch_sub(c->restantes, n);
+		terminaison_envoie(&c->fin, c->message, n, MPI_INT, demandeur, TAG_TUILES);
+		terminaison_don_envoye(&c->fin);
+	} else if (demandeur != rang)
+		envoie(c, (rang + 1) % size, TAG_DEMANDE, demandeur);
+	/* sinon notre demande a fait le tour : rien à prendre, on attend ARRET */
+}
+
+/* traite les messages arrivés ; si attend, attend au moins le premier ; true si au moins un */
+static bool sonde(struct communication *c, bool attend)
+{
+	bool recu = false;
+	for (;;) {
+		MPI_Status status;
+		int flag = 1;
+		if (attend)
+			MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+		else
+			MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+		if (!flag)
+			return recu;
+		traite(c, &status);
+		attend = false;
+		recu = true;
+	}
+}
+
+static void sonde_vide(void *c)
+{
+	sonde(c, false);
+}
+
+static void communique(struct communication *c)
+{
+	long attente = 0;
+	for (;;) {
+		if (atomic_load(c->restantes) > 0) {
+			/* actif : les threads de calcul rendent ; on sert les demandes des autres */
+			if (sonde(c, false))
+				attente = 0;
+			else
+				patiente(&attente);
+			continue;
+		}
+		/* passif : rien ne change plus dans le nœud sans message */
+		terminaison_passif(&c->fin);
+		if (c->fin.arret)
+			break;
+		if (!c->demande) {
+			envoie(c, (c->tr->rang + 1) % c->tr->size, TAG_DEMANDE, c->tr->rang);
+			c->demande = true;
+		}
+		sonde(c, true);
+		attente = 0;
+	}
+	terminaison_vide(&c->fin, sonde_vide, c);
+}
+
+void strategie_hybride(struct travail *tr)
+{
+	int w = tr->cam->w, h = tr->cam->h, rang = tr->rang, size = tr->size;
+
+	int niveau;
+	MPI_Query_thread(&niveau);
+	if (niveau < MPI_THREAD_FUNNELED) {
+		if (rang == 0)
+			fprintf(stderr, "hybrid : MPI_THREAD_FUNNELED non disponible, ring à la place\n");
+		strategie_anneau(tr);
+		return;
+	}
+
+	/* une file par thread de calcul, plus celle du thread de communication, qui reçoit
+	   les tuiles données par les autres processus */
+	int nb_calcul = omp_get_max_threads();
+	struct tuiles tp;
+	tuiles_init(&tp, w, h, nb_calcul + 1);
+	int premiere = tp.nb * rang / size, derniere = tp.nb * (rang + 1) / size;
+	tuiles_repartit(&tp, premiere, derniere, nb_calcul);
+	atomic_long restantes = derniere - premiere;
+
+	/* au plus : des tuiles ou une demande transmise à chaque autre processus, ARRET à
+	   tous, notre demande et le jeton */
+	int taille_tampon = (4 * size + 64) * (MPI_BSEND_OVERHEAD + tp.nb * sizeof(int) + 2 * sizeof(long));
+	void *tampon = malloc(taille_tampon);
+	int *message = malloc(tp.nb * sizeof(int));
+	if (tampon == NULL || message == NULL) {
+		perror("Impossible d'allouer les messages");
+		exit(1);
+	}
+	MPI_Buffer_attach(tampon, taille_tampon);
+
+	struct communication c = {tr, &tp, &tp.deques[nb_calcul], &restantes, message};
+	c.graine = 2654435761u * (rang * (nb_calcul + 1) + 1);
+	terminaison_init(&c.fin, tr);
+	atomic_bool arret = false;
+
+	struct releve *releves = calloc(nb_calcul, sizeof(*releves));  /* un par thread de calcul */
+	if (releves == NULL) {
+		perror("Impossible d'allouer les relevés");
+		exit(1);
+	}
+	long pixels = 0;
+	long long rayons = 0;
+	double calcul = 0, dernier = tr->dernier;
+	double horloge = MPI_Wtime() - omp_get_wtime();        /* les threads de calcul n'appellent pas MPI */
+
+	#pragma omp parallel num_threads(nb_calcul + 1) reduction(+:pixels, rayons, calcul) reduction(max:dernier)
+	{
+		int moi = omp_get_thread_num() - 1;     /* -1 : thread de communication */
+		unsigned graine = 2654435761u * (rang * (nb_calcul + 1) + moi + 2);
+
+		/* chaque thread de calcul sur son cœur (--bind), puis, sur le rang 0, première
+		   écriture des pixels de ses tuiles, avant que quiconque ne calcule */
+		placement_epingle(moi, nb_calcul);
+		if (moi >= 0 && tr->image != NULL)
+			tuiles_premier_contact(&tp, premiere, derniere, nb_calcul, moi, tr->image, false);
+		#pragma omp barrier
+
+		if (moi < 0) {
+			communique(&c);
+			atomic_store(&arret, true);
+		} else {
+			/* ses tuiles, puis celles volées aux autres threads et celles reçues des
+			   autres processus, jusqu'à la fin */
+			int tuile;
+			long attente = 0;
+			while (!atomic_load(&arret)) {
+				if (!tuiles_prend(&tp, moi, &graine, &tuile)) {
+					patiente(&attente);
+					continue;
+				}
+				attente = 0;
+				int x0, y0, x1, y1;
+				tuiles_pixels(&tp, tuile, &x0, &y0, &x1, &y1);
+				double debut = omp_get_wtime();
+				for (int i = y0; i < y1; i++) {
+					double *ligne = distribue_place(tr, &releves[moi], (long) i * w + x0, x1 - x0);
+					for (int j = x0; j < x1; j++)
+						rayons += render_pixel(tr->sc, tr->cam, i, j, tr->samples, ligne + 3 * (j - x0));
+				}
+				double fin = omp_get_wtime();
+				calcul += fin - debut;
+				dernier = fin + horloge;
+				pixels += (long) (x1 - x0) * (y1 - y0);
+				atomic_fetch_sub(&restantes, 1);
+			}
+		}
+	}
+	tr->pixels += pixels;
+	tr->rayons += rayons;
+	tr->calcul += calcul / nb_calcul;       /* par cœur */
+	tr->dernier = dernier;
+	for (int k = 0; k < nb_calcul; k++)
+		releve_concatene(&tr->releve, &releves[k]);
+	free(releves);
+
+	int taille_detachee;
+	MPI_Buffer_detach(&tampon, &taille_detachee);
+	free(tampon);
+	free(message);
+	tuiles_free(&tp);
+	distribue_rassemble(tr);
+}
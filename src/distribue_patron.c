@@ -0,0 +1,332 @@
+/* Stratégies maître/ouvriers rows et nodes (voir distribue.h). */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "distribue.h"
+
+enum { TAG_FIN, TAG_LIGNE, TAG_DEMANDE, TAG_PAQUET, TAG_LIGNES };
+
+#define AVANCE 2                /* lignes attribuées d'avance à chaque ouvrier (rows, nodes) */
+#define MORCEAUX 8              /* rows : morceaux de ligne entre lesquels on fait avancer les envois */
+
+/* Chaque ouvrier commence par les lignes rang - 1 + k * (size - 1), k < AVANCE, sans
+   rien demander, et en garde toujours AVANCE d'avance : il envoie chaque ligne
+   calculée au maître sans attendre (MPI_Isend) et entame la suivante, pendant que le
+   maître lui répond par le numéro d'une nouvelle ligne (ou TAG_FIN). L'aller-retour
+   est caché derrière le calcul d'une ligne. Le maître ne calcule pas. */
+void strategie_lignes(struct travail *tr)
+{
+	int w = tr->cam->w, h = tr->cam->h;
+	if (tr->size == 1) {
+		for (int i = 0; i < h; i++)
+			distribue_ligne(tr, i, 0, w, tr->image + 3L * i * w);
+		return;
+	}
+
+	if (tr->rang == 0) {
+		/* lignes attribuées à l'ouvrier r, dans l'ordre où il les rend : ligne[AVANCE * r + k], k < nb[r] */
+		int *ligne = malloc(AVANCE * tr->size * sizeof(*ligne));
+		int *nb = calloc(tr->size, sizeof(*nb));
+		bool *fin = calloc(tr->size, sizeof(*fin));    /* TAG_FIN envoyé */
+		if (ligne == NULL || nb == NULL || fin == NULL) {
+			perror("Impossible d'allouer les lignes des ouvriers");
+			exit(1);
+		}
+		int suivante = 0, attendues = 0;
+		for (int k = 0; k < AVANCE; k++)
+			for (int r = 1; r < tr->size; r++, suivante++)
+				if (suivante < h) {
+					ligne[AVANCE * r + nb[r]++] = suivante;
+					attendues++;
+				}
+		if (suivante > h)
+			suivante = h;
+		for (int r = 1; r < tr->size; r++)
+			if (nb[r] == 0) {
+				MPI_Send(&suivante, 1, MPI_INT, r, TAG_FIN, MPI_COMM_WORLD);
+				tr->messages++;
+				fin[r] = true;
+			}
+		while (attendues > 0) {
+			MPI_Status status;
+			MPI_Probe(MPI_ANY_SOURCE, TAG_LIGNE, MPI_COMM_WORLD, &status);
+			int r = status.MPI_SOURCE, *file = ligne + AVANCE * r;
+			MPI_Recv(tr->image + 3L * file[0] * w, 3 * w, MPI_DOUBLE, r, TAG_LIGNE, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			for (int k = 1; k < nb[r]; k++)
+				file[k - 1] = file[k];
+			nb[r]--;
+			attendues--;
+			if (suivante < h) {
+				file[nb[r]++] = suivante;
+				attendues++;
+				MPI_Send(&suivante, 1, MPI_INT, r, TAG_LIGNE, MPI_COMM_WORLD);
+				tr->messages++;
+				suivante++;
+			} else if (!fin[r]) {
+				MPI_Send(&suivante, 1, MPI_INT, r, TAG_FIN, MPI_COMM_WORLD);
+				tr->messages++;
+				fin[r] = true;
+			}
+		}
+		free(ligne);
+		free(nb);
+		free(fin);
+		return;
+	}
+
+	/* un tampon par ligne dont l'envoi peut être en cours */
+	double *calculee = malloc(AVANCE * 3 * w * sizeof(*calculee));
+	if (calculee == NULL) {
+		perror("Impossible d'allouer une ligne");
+		exit(1);
+	}
+	MPI_Request envois[AVANCE], reponse;
+	int file[AVANCE], nb = 0, recue;
+	for (int k = 0; k < AVANCE; k++) {
+		envois[k] = MPI_REQUEST_NULL;
+		int i = tr->rang - 1 + k * (tr->size - 1);
+		if (i < h)
+			file[nb++] = i;
+	}
+	bool fin = false;
+	MPI_Irecv(&recue, 1, MPI_INT, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &reponse);
+	for (int k = 0; ; k = (k + 1) % AVANCE) {
+		/* les réponses arrivées ; on n'attend que si on n'a plus rien à rendre */
+		while (!fin) {
+			MPI_Status status;
+			int arrivee = 1;
+			if (nb == 0)
+				MPI_Wait(&reponse, &status);
+			else
+				MPI_Test(&reponse, &arrivee, &status);
+			if (!arrivee)
+				break;
+			if (status.MPI_TAG == TAG_FIN)
+				fin = true;
+			else {
+				file[nb++] = recue;
+				MPI_Irecv(&recue, 1, MPI_INT, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &reponse);
+			}
+		}
+		if (nb == 0)
+			break;
+		int i = file[0];
+		for (int l = 1; l < nb; l++)
+			file[l - 1] = file[l];
+		nb--;
+
+		/* sans thread de progression, un gros message n'avance que pendant les appels
+		   MPI : on relance les envois entre deux morceaux de la ligne */
+		double *tampon = calculee + 3L * w * k;
+		MPI_Wait(&envois[k], MPI_STATUS_IGNORE);
+		for (int m = 0; m < MORCEAUX; m++) {
+			int flag;
+			int j0 = w * m / MORCEAUX;
+			distribue_ligne(tr, i, j0, w * (m + 1) / MORCEAUX, tampon + 3 * j0);
+			MPI_Testall(AVANCE, envois, &flag, MPI_STATUSES_IGNORE);
+		}
+		MPI_Isend(tampon, 3 * w, MPI_DOUBLE, 0, TAG_LIGNE, MPI_COMM_WORLD, &envois[k]);
+		tr->messages++;
+	}
+	MPI_Waitall(AVANCE, envois, MPI_STATUSES_IGNORE);
+	free(calculee);
+}
+
+/* nodes : plages de lignes [debut, fin) */
+struct plage {
+	int debut, fin;
+};
+
+static bool vide(struct plage p)
+{
+	return p.debut == p.fin;
+}
+
+/* un chef de nœud (le processus de rang 0 dans le nœud) */
+struct chef {
+	struct travail *tr;
+	int taille;                     /* processus du nœud, chef compris */
+	int nb_chefs;
+	int suivante;                   /* rang 0 : première ligne pas encore distribuée */
+	struct plage en_cours, reserve; /* lignes du nœud : on redemande dès qu'on entame en_cours */
+	bool en_demande;                /* une demande de paquet est en route vers le rang 0 */
+	bool epuise;                    /* le rang 0 n'a plus de lignes */
+	int *attente, nb_attente;       /* ouvriers du nœud qui attendent une ligne */
+	int ouvriers;                   /* demandes d'ouvriers pas encore servies par la plage vide (fin) */
+	int chefs;                      /* rang 0 : autres chefs qui ne l'ont pas encore reçue */
+};
+
+static void envoie_plage(struct travail *tr, int dest, struct plage p)
+{
+	MPI_Send(&p, 2, MPI_INT, dest, TAG_LIGNES, MPI_COMM_WORLD);
+	tr->messages++;
+}
+
+/* rang 0 : paquet de lignes pour un nœud de taille processus ; guidé (la moitié
+   des lignes restantes, partagée entre les nœuds), mais au moins une ligne par
+   processus du nœud */
+static struct plage paquet(struct chef *c, int taille)
+{
+	int reste = c->tr->cam->h - c->suivante;
+	int k = reste / (2 * c->nb_chefs);
+	if (k < taille)
+		k = taille;
+	if (k > reste)
+		k = reste;
+	struct plage p = {c->suivante, c->suivante + k};
+	c->suivante += k;
+	return p;
+}
+
+/* remplit la réserve : directement pour le rang 0, par une demande au rang 0 sinon */
+static void reapprovisionne(struct chef *c)
+{
+	if (!vide(c->reserve) || c->epuise || c->en_demande)
+		return;
+	if (c->tr->rang == 0) {
+		c->reserve = paquet(c, c->taille);
+		c->epuise = vide(c->reserve);
+	} else {
+		MPI_Send(&c->taille, 1, MPI_INT, 0, TAG_PAQUET, MPI_COMM_WORLD);
+		c->tr->messages++;
+		c->en_demande = true;
+	}
+}
+
+/* ligne suivante du nœud, -1 si elle n'est pas (encore) là */
+static int prend(struct chef *c)
+{
+	reapprovisionne(c);
+	if (vide(c->en_cours)) {
+		c->en_cours = c->reserve;
+		c->reserve = (struct plage) {0, 0};
+		reapprovisionne(c);
+	}
+	return vide(c->en_cours) ? -1 : c->en_cours.debut++;
+}
+
+/* une ligne à chaque ouvrier qui attend, ou la fin s'il n'y en a plus */
+static void sert(struct chef *c)
+{
+	while (c->nb_attente > 0) {
+		int i = prend(c);
+		if (i >= 0)
+			envoie_plage(c->tr, c->attente[--c->nb_attente], (struct plage) {i, i + 1});
+		else if (c->epuise) {
+			envoie_plage(c->tr, c->attente[--c->nb_attente], (struct plage) {0, 0});
+			c->ouvriers--;
+		} else
+			break;
+	}
+}
+
+/* traite les messages arrivés ; si attend, attend au moins le premier */
+static void sonde(struct chef *c, bool attend)
+{
+	for (;;) {
+		MPI_Status status;
+		int flag = 1;
+		if (attend)
+			MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+		else
+			MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+		if (!flag)
+			return;
+		attend = false;
+
+		int m[2];
+		MPI_Recv(m, 2, MPI_INT, status.MPI_SOURCE, status.MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+		switch (status.MPI_TAG) {
+		case TAG_DEMANDE:               /* d'un ouvrier du nœud */
+			c->attente[c->nb_attente++] = status.MPI_SOURCE;
+			break;
+		case TAG_PAQUET: {              /* rang 0, d'un autre chef : m[0] processus */
+			struct plage p = paquet(c, m[0]);
+			envoie_plage(c->tr, status.MPI_SOURCE, p);
+			if (vide(p))
+				c->chefs--;
+			break;
+		}
+		case TAG_LIGNES:                /* du rang 0 */
+			c->reserve = (struct plage) {m[0], m[1]};
+			c->epuise = vide(c->reserve);
+			c->en_demande = false;
+			break;
+		}
+	}
+}
+
+/* Le rang 0 ne sert que les chefs de nœud (MPI_Comm_split_type), en paquets de
+   lignes, et chaque chef sert les lignes de son paquet aux processus de son nœud,
+   une par une : le rang 0 reçoit un message par paquet et non par ligne, et les
+   allers-retours des ouvriers restent dans le nœud. Le rang 0 et les chefs rendent
+   aussi leurs lignes, pixel par pixel en regardant entre deux pixels si une
+   demande est arrivée. Un ouvrier garde AVANCE demandes en route : il redemande
+   une ligne dès qu'il en reçoit une, avant de la rendre. Chacun garde ses lignes
+   dans son relevé, rassemblé à la fin. */
+void strategie_noeuds(struct travail *tr)
+{
+	int w = tr->cam->w;
+	MPI_Comm comm_noeud;
+	int rang_noeud, taille_noeud, chef = tr->rang;
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &comm_noeud);
+	MPI_Comm_rank(comm_noeud, &rang_noeud);
+	MPI_Comm_size(comm_noeud, &taille_noeud);
+	MPI_Bcast(&chef, 1, MPI_INT, 0, comm_noeud);
+	MPI_Comm_free(&comm_noeud);
+	int nb_chefs = (rang_noeud == 0);
+	MPI_Allreduce(MPI_IN_PLACE, &nb_chefs, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+	if (rang_noeud > 0) {
+		/* chaque demande reçoit une réponse ; après une plage vide, toutes les
+		   suivantes le sont aussi */
+		for (int k = 0; k < AVANCE; k++) {
+			MPI_Send(&tr->rang, 1, MPI_INT, chef, TAG_DEMANDE, MPI_COMM_WORLD);
+			tr->messages++;
+		}
+		for (int attendues = AVANCE; attendues > 0; ) {
+			struct plage p;
+			MPI_Recv(&p, 2, MPI_INT, chef, TAG_LIGNES, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			if (vide(p)) {
+				attendues--;
+				continue;
+			}
+			MPI_Send(&tr->rang, 1, MPI_INT, chef, TAG_DEMANDE, MPI_COMM_WORLD);
+			tr->messages++;
+			for (int i = p.debut; i < p.fin; i++)
+				distribue_ligne(tr, i, 0, w, distribue_place(tr, &tr->releve, (long) i * w, w));
+		}
+		distribue_rassemble(tr);
+		return;
+	}
+
+	struct chef c = {tr, taille_noeud, nb_chefs};
+	c.ouvriers = AVANCE * (taille_noeud - 1);
+	c.chefs = (tr->rang == 0) ? nb_chefs - 1 : 0;
+	c.attente = malloc(AVANCE * taille_noeud * sizeof(int));
+	if (c.attente == NULL) {
+		perror("Impossible d'allouer la file des ouvriers");
+		exit(1);
+	}
+	int i = -1, j = 0;              /* ligne rendue par le chef, et son pixel suivant */
+	for (;;) {
+		sert(&c);
+		if (i < 0) {
+			i = prend(&c);
+			j = 0;
+		}
+		if (i >= 0) {
+			distribue_ligne(tr, i, j, j + 1, distribue_place(tr, &tr->releve, (long) i * w + j, 1));
+			if (++j == w)
+				i = -1;
+			sonde(&c, false);
+			continue;
+		}
+		if (c.epuise && c.ouvriers == 0 && c.chefs == 0)
+			break;
+		sonde(&c, true);
+	}
+	free(c.attente);
+	distribue_rassemble(tr);
+}
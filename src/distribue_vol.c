@@ -0,0 +1,244 @@
+/* Stratégies ring et random : vol de la moitié d'une plage (voir distribue.h).
+ *
+ * Chaque processus commence par son bloc de positions du parcours et rend sa
+ * plage [actual, end) pixel après pixel, en regardant entre deux pixels si
+ * un message est arrivé. Un processus sans travail envoie une demande ;
+ * celui qui la reçoit et a plus de 2 * DON_MIN pixels devant lui en donne la
+ * seconde moitié. Avec ring, une demande refusée passe au processus suivant
+ * de l'anneau (si elle revient à son auteur, il n'y a plus rien à prendre et
+ * il attend la fin) ; avec random, elle est refusée (RIEN) et le demandeur
+ * tire une autre victime.
+ *
+ * Fin : détection de terminaison de Dijkstra et Safra (EWD998). Un
+ * processus est actif tant qu'il a une plage ; seuls les dons (DON) rendent
+ * actif. Chacun compte les dons envoyés moins les dons reçus, et devient
+ * noir quand il en reçoit un. Un jeton fait le tour de l'anneau en partant
+ * du rang 0 ; un processus ne le passe que quand il est passif, en y
+ * ajoutant son compte (et sa couleur s'il est noir, puis il redevient
+ * blanc). Quand le jeton revient blanc au rang 0 blanc et passif, avec une
+ * somme nulle, aucun processus n'est actif et aucun don n'est en route : le
+ * rang 0 envoie ARRET à tous. Sinon il relance un tour. Les messages encore
+ * en route (demandes, refus) sont vidés avant de rassembler l'image. Cette
+ * terminaison (terminaison_*, distribue.h) sert aussi à hybrid.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "distribue.h"
+
+enum { TAG_DEMANDE = 20, TAG_DON, TAG_RIEN };
+
+struct vol {
+	struct travail *tr;
+	bool anneau;                    /* ring, sinon random */
+	long actual, end;               /* plage en cours */
+	bool demande;                   /* une demande de ce processus est en route */
+	struct terminaison fin;
+	unsigned graine;
+};
+
+void terminaison_init(struct terminaison *f, struct travail *tr)
+{
+	*f = (struct terminaison) {tr};
+	f->jeton = tr->rang == 0;
+}
+
+void terminaison_envoie(struct terminaison *f, const void *m, int nb, MPI_Datatype type, int dest, int tag)
+{
+	MPI_Bsend(m, nb, type, dest, tag, MPI_COMM_WORLD);
+	f->envoyes++;
+	f->tr->messages++;
+}
+
+void terminaison_don_envoye(struct terminaison *f)
+{
+	f->compteur++;
+}
+
+void terminaison_don_recu(struct terminaison *f)
+{
+	f->compteur--;
+	f->noir = true;
+}
+
+static void envoie_jeton(struct terminaison *f, int dest, int tag, long somme, bool noir)
+{
+	long m[2] = {somme, noir};
+	terminaison_envoie(f, m, 2, MPI_LONG, dest, tag);
+}
+
+void terminaison_passif(struct terminaison *f)
+{
+	if (!f->jeton)
+		return;
+	int rang = f->tr->rang, size = f->tr->size, suivant = (rang + 1) % size;
+	if (rang == 0) {
+		if (size == 1 || (f->tour && !f->jeton_noir && !f->noir && f->jeton_somme + f->compteur == 0)) {
+			for (int r = 1; r < size; r++)
+				envoie_jeton(f, r, TAG_ARRET, 0, false);
+			f->arret = true;
+			return;
+		}
+		envoie_jeton(f, suivant, TAG_JETON, 0, false);
+		f->tour = true;
+	} else
+		envoie_jeton(f, suivant, TAG_JETON, f->jeton_somme + f->compteur, f->jeton_noir || f->noir);
+	f->noir = false;
+	f->jeton = false;
+}
+
+bool terminaison_recoit(struct terminaison *f, int tag, const long *m)
+{
+	switch (tag) {
+	case TAG_JETON:
+		f->jeton = true;
+		f->jeton_somme = m[0];
+		f->jeton_noir = m[1];
+		return true;
+	case TAG_ARRET:
+		f->arret = true;
+		return true;
+	}
+	return false;
+}
+
+/* quand tous sont entrés dans la barrière, plus personne n'envoie de nouveaux
+   messages ; il reste à recevoir autant de messages qu'il en a été envoyé */
+void terminaison_vide(struct terminaison *f, void (*sonde)(void *ctx), void *ctx)
+{
+	MPI_Request barriere;
+	MPI_Ibarrier(MPI_COMM_WORLD, &barriere);
+	for (int fini = 0; !fini; ) {
+		sonde(ctx);
+		MPI_Test(&barriere, &fini, MPI_STATUS_IGNORE);
+	}
+	for (;;) {
+		long bilan[2] = {f->envoyes, f->recus};
+		MPI_Allreduce(MPI_IN_PLACE, bilan, 2, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+		if (bilan[0] == bilan[1])
+			break;
+		sonde(ctx);
+	}
+}
+
+static void envoie(struct vol *v, int dest, int tag, long a, long b)
+{
+	long m[2] = {a, b};
+	terminaison_envoie(&v->fin, m, 2, MPI_LONG, dest, tag);
+}
+
+/* un autre processus, au hasard */
+static int victime(struct vol *v)
+{
+	int r = tuiles_alea(&v->graine) % (v->tr->size - 1);
+	return (r >= v->tr->rang) ? r + 1 : r;
+}
+
+static void traite(struct vol *v, const MPI_Status *status)
+{
+	long m[2];
+	MPI_Recv(m, 2, MPI_LONG, status->MPI_SOURCE, status->MPI_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+	v->fin.recus++;
+	if (terminaison_recoit(&v->fin, status->MPI_TAG, m))
+		return;
+	int rang = v->tr->rang, size = v->tr->size;
+	switch (status->MPI_TAG) {
+	case TAG_DEMANDE: {
+		int demandeur = m[0];
+		long moitie = (v->end - v->actual) / 2;
+		if (v->fin.arret)
+			break;                  /* plus personne n'attend de réponse */
+		if (moitie > DON_MIN) {
+			envoie(v, demandeur, TAG_DON, v->end - moitie, v->end);
+			v->end -= moitie;
+			terminaison_don_envoye(&v->fin);
+		} else if (!v->anneau)
+			envoie(v, demandeur, TAG_RIEN, 0, 0);
+		else if (demandeur != rang)
+			envoie(v, (rang + 1) % size, TAG_DEMANDE, demandeur, 0);
+		/* sinon notre demande a fait le tour : rien à prendre, on attend ARRET */
+		break;
+	}
+	case TAG_DON:
+		v->actual = m[0];
+		v->end = m[1];
+		v->demande = false;
+		terminaison_don_recu(&v->fin);
+		break;
+	case TAG_RIEN:
+		v->demande = false;
+		break;
+	}
+}
+
+/* traite les messages arrivés ; si attend, attend au moins le premier */
+static void sonde(struct vol *v, bool attend)
+{
+	for (;;) {
+		MPI_Status status;
+		int flag = 1;
+		if (attend)
+			MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+		else
+			MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, &status);
+		if (!flag)
+			return;
+		traite(v, &status);
+		attend = false;
+	}
+}
+
+static void sonde_vide(void *v)
+{
+	sonde(v, false);
+}
+
+static void vole(struct travail *tr, bool anneau)
+{
+	long n = (long) tr->cam->w * tr->cam->h;
+	struct vol v = {tr, anneau, n * tr->rang / tr->size, n * (tr->rang + 1) / tr->size};
+	v.graine = 2654435761u * (tr->rang + 1);
+	terminaison_init(&v.fin, tr);
+
+	/* au plus : une réponse à chaque autre processus, ARRET à tous, notre demande et le jeton */
+	int taille_tampon = (4 * tr->size + 64) * (MPI_BSEND_OVERHEAD + 2 * sizeof(long));
+	void *tampon = malloc(taille_tampon);
+	if (tampon == NULL) {
+		perror("Impossible d'allouer les messages");
+		exit(1);
+	}
+	MPI_Buffer_attach(tampon, taille_tampon);
+
+	for (;;) {
+		if (v.actual < v.end) {
+			distribue_pixel(tr, v.actual++);
+			sonde(&v, false);
+			continue;
+		}
+		terminaison_passif(&v.fin);
+		if (v.fin.arret)
+			break;
+		if (!v.demande) {
+			envoie(&v, anneau ? (tr->rang + 1) % tr->size : victime(&v), TAG_DEMANDE, tr->rang, 0);
+			v.demande = true;
+		}
+		sonde(&v, true);
+	}
+	terminaison_vide(&v.fin, sonde_vide, &v);
+
+	int taille_detachee;
+	MPI_Buffer_detach(&tampon, &taille_detachee);
+	free(tampon);
+	distribue_rassemble(tr);
+}
+
+void strategie_anneau(struct travail *tr)
+{
+	vole(tr, true);
+}
+
+void strategie_hasard(struct travail *tr)
+{
+	vole(tr, false);
+}
@@ -0,0 +1,243 @@
+/* Placement mémoire et épinglage des threads (voir placement.h). */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <omp.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "placement.h"
+
+#define GRANDE_PAGE (2L << 20)
+#define NOEUDS_MAX 64           /* nœuds comptés par le rapport */
+
+enum epinglage placement_epinglage = EPINGLE_AUCUN;
+bool placement_grandes_pages = false;
+
+static const char *noms[] = {"none", "compact", "spread"};
+
+static int *coeurs, nb_coeurs;  /* cœurs du processus, dans l'ordre des numéros */
+static bool masque_lanceur;     /* le masque d'affinité était déjà restreint au lancement */
+static bool partage;            /* pas de masque du lanceur : cœurs du nœud partagés entre ses processus */
+static int rang, nb_rangs;      /* rang parmi les processus du nœud */
+static int *cpu, *noeud;        /* cœur et nœud de chaque thread (omp_get_thread_num()), -1 : inconnu */
+static bool *auxiliaire;
+static int nb_threads;
+static const char *pages = "petites pages";    /* ce que placement_alloc() a obtenu */
+
+bool placement_cherche(const char *nom, enum epinglage *e)
+{
+	for (int k = 0; k < 3; k++)
+		if (strcmp(nom, noms[k]) == 0) {
+			*e = k;
+			return true;
+		}
+	return false;
+}
+
+void placement_init(int rang_local, int nb_locaux, int n)
+{
+	cpu_set_t masque;
+	if (sched_getaffinity(0, sizeof(masque), &masque) != 0) {
+		perror("sched_getaffinity");
+		exit(1);
+	}
+	int m = CPU_COUNT(&masque);
+	coeurs = malloc(m * sizeof(*coeurs));
+	cpu = malloc(n * sizeof(*cpu));
+	noeud = malloc(n * sizeof(*noeud));
+	auxiliaire = calloc(n, sizeof(*auxiliaire));
+	if (coeurs == NULL || cpu == NULL || noeud == NULL || auxiliaire == NULL) {
+		perror("Impossible d'allouer le placement");
+		exit(1);
+	}
+	nb_threads = n;
+	for (int t = 0; t < n; t++)
+		cpu[t] = noeud[t] = -1;
+	rang = rang_local;
+	nb_rangs = nb_locaux;
+
+	/* tous les cœurs du nœud : le lanceur n'a rien fixé, on prend notre part */
+	masque_lanceur = m < sysconf(_SC_NPROCESSORS_ONLN);
+	partage = !masque_lanceur && nb_locaux > 1 && nb_locaux <= m;
+	int a = 0, b = m;
+	if (partage) {
+		a = (long) m * rang_local / nb_locaux;
+		b = (long) m * (rang_local + 1) / nb_locaux;
+	}
+	nb_coeurs = 0;
+	for (int c = 0, k = 0; c < CPU_SETSIZE && k < b; c++)
+		if (CPU_ISSET(c, &masque) && k++ >= a)
+			coeurs[nb_coeurs++] = c;
+}
+
+void placement_epingle(int k, int n)
+{
+	if (placement_epinglage != EPINGLE_AUCUN && nb_coeurs > 0) {
+		cpu_set_t s;
+		CPU_ZERO(&s);
+		if (k < 0)
+			for (int c = 0; c < nb_coeurs; c++)
+				CPU_SET(coeurs[c], &s);
+		else if (placement_epinglage == EPINGLE_COMPACT)
+			CPU_SET(coeurs[k % nb_coeurs], &s);
+		else
+			CPU_SET(coeurs[(long) k * nb_coeurs / n % nb_coeurs], &s);
+		if (sched_setaffinity(0, sizeof(s), &s) != 0)
+			perror("sched_setaffinity");
+	}
+	int t = omp_get_thread_num();
+	if (t < nb_threads) {
+		unsigned c, nd;
+		if (getcpu(&c, &nd) == 0) {
+			cpu[t] = c;
+			noeud[t] = nd;
+		}
+		auxiliaire[t] = k < 0;
+	}
+}
+
+static size_t arrondi(size_t taille)
+{
+	size_t p = placement_grandes_pages ? GRANDE_PAGE : sysconf(_SC_PAGESIZE);
+	return (taille + p - 1) / p * p;
+}
+
+void *placement_alloc(size_t taille)
+{
+	size_t t = arrondi(taille);
+	void *p = MAP_FAILED;
+	if (placement_grandes_pages) {
+		p = mmap(NULL, t, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		pages = "hugetlbfs 2 Mo";
+	}
+	if (p == MAP_FAILED) {
+		p = mmap(NULL, t, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) {
+			perror("Impossible d'allouer l'image");
+			exit(1);
+		}
+		/* pas de grandes pages réservées : pages transparentes, si le noyau veut bien */
+		pages = "petites pages";
+		if (placement_grandes_pages)
+			pages = (madvise(p, t, MADV_HUGEPAGE) == 0) ? "pages transparentes (MADV_HUGEPAGE)"
+				: "petites pages (MADV_HUGEPAGE refusé)";
+	}
+	return p;
+}
+
+void placement_free(void *p, size_t taille)
+{
+	munmap(p, arrondi(taille));
+}
+
+/* "0-3,8-11" */
+static void liste(char *s, size_t n, const int *c, int nb)
+{
+	size_t l = 0;
+	s[0] = 0;
+	for (int k = 0; k < nb && l < n; ) {
+		int f = k;
+		while (f + 1 < nb && c[f + 1] == c[f] + 1)
+			f++;
+		l += (f > k) ? snprintf(s + l, n - l, "%s%d-%d", l ? "," : "", c[k], c[f])
+			: snprintf(s + l, n - l, "%s%d", l ? "," : "", c[k]);
+		k = f + 1;
+	}
+}
+
+/* AnonHugePages (ko) des zones de /proc/self/smaps qui recouvrent [p, p + taille) */
+static long grandes_pages_transparentes(const void *p, size_t taille)
+{
+	FILE *f = fopen("/proc/self/smaps", "r");
+	if (f == NULL)
+		return -1;
+	unsigned long a = (unsigned long) p, b = a + taille, debut, fin;
+	char ligne[256];
+	bool dedans = false;
+	long ko = 0, v;
+	while (fgets(ligne, sizeof(ligne), f) != NULL) {
+		if (sscanf(ligne, "%lx-%lx ", &debut, &fin) == 2)
+			dedans = debut < b && fin > a;
+		else if (dedans && sscanf(ligne, "AnonHugePages: %ld kB", &v) == 1)
+			ko += v;
+	}
+	fclose(f);
+	return ko;
+}
+
+void placement_rapport(FILE *sortie, const char *qui, const void *p, size_t taille)
+{
+	/* écrit d'un seul coup : les lignes des processus ne se mélangent pas */
+	char *texte;
+	size_t longueur;
+	FILE *f = open_memstream(&texte, &longueur);
+	if (f == NULL) {
+		perror("open_memstream");
+		return;
+	}
+
+	/* threads ; * : thread auxiliaire */
+	char s[4096];
+	liste(s, sizeof(s), coeurs, nb_coeurs);
+	if (masque_lanceur)
+		fprintf(f, "%s : cœurs %s (masque du lanceur)", qui, s);
+	else if (partage)
+		fprintf(f, "%s : cœurs %s (part %d/%d du nœud)", qui, s, rang, nb_rangs);
+	else
+		fprintf(f, "%s : cœurs %s (tout le nœud)", qui, s);
+	fprintf(f, ", --bind %s, thread>cœur/nœud :", noms[placement_epinglage]);
+	for (int t = 0; t < nb_threads; t++)
+		fprintf(f, " %d%s>%d/%d", t, auxiliaire[t] ? "*" : "", cpu[t], noeud[t]);
+	fprintf(f, "\n");
+
+	/* pages : move_pages() sans nœuds cibles donne le nœud de chaque page, ou -ENOENT
+	   si elle n'a jamais été touchée */
+	long lp = sysconf(_SC_PAGESIZE), n = (taille + lp - 1) / lp;
+	long par_noeud[NOEUDS_MAX] = {0}, absentes = 0, autres = 0;
+	enum { PAQUET = 1024 };
+	void *adr[PAQUET];
+	int etat[PAQUET];
+	bool ok = true;
+	for (long k = 0; k < n && ok; k += PAQUET) {
+		long m = (n - k < PAQUET) ? n - k : PAQUET;
+		for (long q = 0; q < m; q++)
+			adr[q] = (char *) p + (k + q) * lp;
+		if (syscall(SYS_move_pages, 0, m, adr, NULL, etat, 0) != 0) {
+			ok = false;
+			break;
+		}
+		for (long q = 0; q < m; q++) {
+			if (etat[q] >= 0 && etat[q] < NOEUDS_MAX)
+				par_noeud[etat[q]]++;
+			else if (etat[q] == -ENOENT)
+				absentes++;
+			else
+				autres++;
+		}
+	}
+	fprintf(f, "%s : image %.1f Mo, %s", qui, taille / 1e6, pages);
+	long thp = grandes_pages_transparentes(p, taille);
+	if (thp > 0)
+		fprintf(f, " (%ld ko en grandes pages)", thp);
+	if (!ok)
+		fprintf(f, ", nœuds des pages inconnus (move_pages : %s)\n", strerror(errno));
+	else {
+		fprintf(f, ", pages par nœud :");
+		for (int nd = 0; nd < NOEUDS_MAX; nd++)
+			if (par_noeud[nd] > 0)
+				fprintf(f, " %d:%ld", nd, par_noeud[nd]);
+		fprintf(f, ", jamais touchées %ld", absentes);
+		if (autres > 0)
+			fprintf(f, ", illisibles %ld", autres);
+		fprintf(f, "\n");
+	}
+	fclose(f);
+	fputs(texte, sortie);
+	fflush(sortie);
+	free(texte);
+}
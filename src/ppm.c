@@ -0,0 +1,41 @@
+/* Écriture de l'image au format NetPbm (voir ppm.h). */
+#include <math.h>
+#include <pwd.h>       /* pour getpwuid */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>  /* pour mkdir    */
+#include <sys/types.h>
+#include <unistd.h>    /* pour getuid   */
+
+#include "ppm.h"
+
+int toInt(double x)
+{
+	return pow(x, 1 / 2.2) * 255 + .5;   /* gamma correction = 2.2 */
+}
+
+void ppm_ecrit(const char *prefixe, const char *nom, const double *image, int w, int h, bool retourne)
+{
+	char nom_sortie[200] = "";
+	char nom_rep[100] = "";
+
+	struct passwd *pass = getpwuid(getuid());
+	snprintf(nom_rep, sizeof(nom_rep), "%s%s", prefixe, pass->pw_name);
+	mkdir(nom_rep, S_IRWXU);
+	snprintf(nom_sortie, sizeof(nom_sortie), "%s/%s", nom_rep, nom);
+
+	FILE *f = fopen(nom_sortie, "w");
+	if (f == NULL) {
+		perror(nom_sortie);
+		exit(1);
+	}
+	fprintf(f, "P3\n%d %d\n%d\n", w, h, 255);
+	for (int l = 0; l < h; l++) {
+		int i = retourne ? h - 1 - l : l;
+		for (int j = 0; j < w; j++) {
+			const double *p = image + 3 * ((long) i * w + j);
+			fprintf(f, "%d %d %d ", toInt(p[0]), toInt(p[1]), toInt(p[2]));
+		}
+	}
+	fclose(f);
+}
@@ -0,0 +1,166 @@
+/* Rendu progressif et points de reprise (voir progressif.h). */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "blas.h"
+#include "progressif.h"
+
+/* en-tête du point de reprise ; les sommes suivent, en double, dans l'ordre de pg->somme */
+#define REPRISE_MAGIC "PTREPRIS"
+#define REPRISE_VERSION 2           /* 1 : sommes en float, sommées par passe */
+
+struct reprise_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t n;
+	uint64_t hash;
+	int32_t w, h;
+};
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t taille)
+{
+	const unsigned char *octets = data;
+	for (size_t k = 0; k < taille; k++)
+		h = (h ^ octets[k]) * 0x100000001b3ull;
+	return h;
+}
+
+uint64_t progressif_hash(const struct scene *sc)
+{
+	/* champ par champ : les octets de bourrage de struct Sphere ne sont pas initialisés */
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (int i = 0; i < sc->n; i++) {
+		const struct Sphere *s = &sc->spheres[i];
+		h = fnv1a(h, &s->radius, sizeof(s->radius));
+		h = fnv1a(h, s->position, sizeof(s->position));
+		h = fnv1a(h, s->emission, sizeof(s->emission));
+		h = fnv1a(h, s->color, sizeof(s->color));
+		h = fnv1a(h, &s->refl, sizeof(s->refl));
+	}
+	h = fnv1a(h, &render_nee, sizeof(render_nee));
+	return h;
+}
+
+void progressif_init(struct progressif *pg, int w, int h, uint64_t hash)
+{
+	progressif_init_plage(pg, w, h, 0, w * h, hash);
+}
+
+void progressif_init_plage(struct progressif *pg, int w, int h, int debut, int fin, uint64_t hash)
+{
+	pg->w = w;
+	pg->h = h;
+	pg->debut = debut;
+	pg->fin = fin;
+	pg->n = 0;
+	pg->hash = hash;
+	pg->somme = calloc((size_t) (fin - debut) * 12, sizeof(double));
+	if (pg->somme == NULL) {
+		perror("Impossible d'allouer les sommes du rendu progressif");
+		exit(1);
+	}
+}
+
+void progressif_free(struct progressif *pg)
+{
+	free(pg->somme);
+	pg->somme = NULL;
+}
+
+bool progressif_load(struct progressif *pg, const char *path)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		return false;
+	struct reprise_header hd;
+	size_t nb = (size_t) pg->w * pg->h * 12;
+	if (fread(&hd, sizeof(hd), 1, f) != 1 || memcmp(hd.magic, REPRISE_MAGIC, 8) != 0) {
+		fprintf(stderr, "%s : ce n'est pas un point de reprise\n", path);
+		exit(1);
+	}
+	if (hd.version != REPRISE_VERSION) {
+		fprintf(stderr, "%s : point de reprise de version %u (attendue : %d)\n", path, hd.version, REPRISE_VERSION);
+		exit(1);
+	}
+	if (hd.hash != pg->hash || hd.w != pg->w || hd.h != pg->h) {
+		fprintf(stderr, "%s : point de reprise d'un autre rendu (scène, taille ou --nee différents)\n", path);
+		exit(1);
+	}
+	if (fread(pg->somme, sizeof(double), nb, f) != nb) {
+		fprintf(stderr, "%s : point de reprise tronqué\n", path);
+		exit(1);
+	}
+	fclose(f);
+	pg->n = hd.n;
+	return true;
+}
+
+bool progressif_save(const struct progressif *pg, const char *path)
+{
+	/* écrit dans un fichier temporaire puis renomme : un arrêt pendant l'écriture laisse l'ancien point de reprise */
+	char tmp[PATH_MAX];
+	if (snprintf(tmp, sizeof(tmp), "%s.%d", path, (int) getpid()) >= (int) sizeof(tmp))
+		return false;
+	FILE *f = fopen(tmp, "w");
+	if (f == NULL)
+		return false;
+	struct reprise_header hd = {REPRISE_MAGIC, REPRISE_VERSION, pg->n, pg->hash, pg->w, pg->h};
+	size_t nb = (size_t) pg->w * pg->h * 12;
+	bool ok = fwrite(&hd, sizeof(hd), 1, f) == 1 && fwrite(pg->somme, sizeof(double), nb, f) == nb;
+	ok = (fclose(f) == 0) && ok;
+	if (ok)
+		ok = rename(tmp, path) == 0;
+	if (!ok)
+		unlink(tmp);
+	return ok;
+}
+
+long long progressif_passe(struct progressif *pg, const struct scene *sc, const struct camera *cam, int nb)
+{
+	long long nb_rayons = 0;
+	/* chaque pixel ne dépend que de sa position : même résultat quel que soit le nombre de threads */
+	#pragma omp parallel for schedule(dynamic, 64) reduction(+:nb_rayons)
+	for (int p = pg->debut; p < pg->fin; p++)
+		for (int sub = 0; sub < 4; sub++) {
+			/* échantillon par échantillon, dans l'ordre : pas de somme partielle par passe */
+			double *somme = pg->somme + 12 * (p - pg->debut) + 3 * sub;
+			for (int s = pg->n; s < pg->n + nb; s++) {
+				double e[3];
+				nb_rayons += render_sample(sc, cam, p / pg->w, p % pg->w, sub, s, e);
+				axpy(1, e, somme);
+			}
+		}
+	pg->n += nb;
+	return nb_rayons;
+}
+
+void progressif_image(const struct progressif *pg, double *image)
+{
+	for (int p = 0; p < pg->fin - pg->debut; p++) {
+		double *pixel = image + 3 * p;
+		zero(pixel);
+		for (int sub = 0; sub < 4; sub++) {
+			const double *somme = pg->somme + 12 * p + 3 * sub;
+			double e[3] = {somme[0], somme[1], somme[2]};
+			scal(1. / pg->n, e);
+			clamp(e);
+			axpy(0.25, e, pixel);
+		}
+	}
+}
+
+int progressif_pas(uint32_t n, int max, double cout, double restant)
+{
+	int pas = (n < 4) ? 1 : n / 4;
+	if (pas > max)
+		pas = max;
+	if (cout > 0) {
+		double tient = restant / (cout * PROGRESSIF_MARGE);
+		if (tient < pas)
+			pas = (tient > 0) ? (int) tient : 0;
+	}
+	return pas;
+}
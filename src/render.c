@@ -0,0 +1,408 @@
+/* Noyau de rendu commun : caméra, intégrateur de chemins et calcul d'un pixel. */
+#include <math.h>
+#include <omp.h>
+#include <stdbool.h>
+
+#include "blas.h"
+#include "render.h"
+#include "sampler.h"
+
+/******************************* caméra *************************************/
+
+void camera_init(struct camera *cam, int w, int h)
+{
+	static const double CST = 0.5135;  /* ceci défini l'angle de vue */
+	struct camera c = {w, h, {50, 52, 295.6}, {0, -0.042612, -1}, {w * CST / h, 0, 0}};
+	*cam = c;
+	normalize(cam->direction);
+
+	/* incréments pour passer d'un pixel à l'autre */
+	cross(cam->cx, cam->direction, cam->cy);  /* cy est orthogonal à cx ET à la direction dans laquelle regarde la caméra */
+	normalize(cam->cy);
+	scal(CST, cam->cy);
+}
+
+void camera_ray(const struct camera *cam, int i, int j, int sub_i, int sub_j, const double *u,
+		double *ray_origin, double *ray_direction)
+{
+	/* filtre en tente : décalage dans [-1, 1] */
+	double r1 = 2 * u[0];
+	double dx = (r1 < 1) ? sqrt(r1) - 1 : 1 - sqrt(2 - r1); 
+	double r2 = 2 * u[1];
+	double dy = (r2 < 1) ? sqrt(r2) - 1 : 1 - sqrt(2 - r2);
+	copy(cam->direction, ray_direction);
+	axpy(((sub_i + .5 + dy) / 2 + i) / cam->h - .5, cam->cy, ray_direction);
+	axpy(((sub_j + .5 + dx) / 2 + j) / cam->w - .5, cam->cx, ray_direction);
+	normalize(ray_direction);
+
+	copy(cam->position, ray_origin);
+	axpy(140, ray_direction, ray_origin);
+}
+
+/******************************* intersection *************************************/
+
+bool render_scalaire;
+
+/* détermine si le rayon intersecte l'une des spere; si oui renvoie true et fixe t, id */
+bool render_intersect(const struct scene *sc, const double *ray_origin, const double *ray_direction,
+		double *t, int *id)
+{
+	if (render_scalaire)
+		return scene_intersect_scalar(sc->spheres, sc->n, ray_origin, ray_direction, t, id);
+	return scene_intersect(sc, ray_origin, ray_direction, t, id);
+}
+
+/******************************* éclairage direct (--nee) *************************************/
+
+bool render_nee;
+
+/* 1 - cos(angle du cône) sous lequel on voit la sphère L depuis x (calcul stable
+   pour les lumières lointaines) ; 0 si x est dans la sphère */
+static double cone_ouverture(const struct Sphere *L, const double *x)
+{
+	double w[3];
+	copy(L->position, w);
+	axpy(-1, x, w);
+	double s2 = L->radius * L->radius / dot(w, w);     /* sin² de l'angle du cône */
+	if (s2 >= 1)
+		return 0;
+	return s2 / (1 + sqrt(1 - s2));
+}
+
+/* Éclairage direct au point x d'une surface diffuse (normale orientée nl) : pour chaque
+   sphère émissive, une direction uniforme dans le cône qu'elle occupe vu de x et un rayon
+   d'ombre. Combiné avec le rebond diffus (densité cos / pi) par MIS, heuristique de
+   balance : la lumière reçue par le rayon d'ombre a le poids p_l / (p_l + p_b), celle
+   que trouve ensuite le rebond diffus p_b / (p_l + p_b) (voir radiance_hit). Ajoute
+   throughput * luminance à acc ; renvoie le nombre de rayons d'ombre. */
+static int eclairage_direct(const struct scene *sc, int self, const double *x, const double *nl,
+		const double *throughput, const struct rng_path *path, int depth, double *acc)
+{
+	int nb_rayons = 0;
+	for (int l = 0; l < sc->nb_lumieres; l++) {
+		int id = sc->lumieres[l];
+		const struct Sphere *L = &sc->spheres[id];
+		double ouverture = cone_ouverture(L, x);
+		if (id == self || ouverture == 0)
+			continue;
+
+		/* direction dans le cône, autour de l'axe x -> centre de L */
+		double u[4];
+		render_sampler->uniform4(path, depth, 1 + l, u);
+		double un_moins_cos = u[0] * ouverture;
+		double cos_t = 1 - un_moins_cos;
+		double sin_t = sqrt(un_moins_cos * (2 - un_moins_cos));
+		double phi = 2 * M_PI * u[1];
+		double axe[3], a[3], b[3];
+		copy(L->position, axe);
+		axpy(-1, x, axe);
+		normalize(axe);
+		double uw[3] = {0, 0, 0};
+		if (fabs(axe[0]) > .1)
+			uw[1] = 1;
+		else
+			uw[0] = 1;
+		cross(uw, axe, a);
+		normalize(a);
+		cross(axe, a, b);
+		double direction[3];
+		zero(direction);
+		axpy(cos_t, axe, direction);
+		axpy(sin_t * cos(phi), a, direction);
+		axpy(sin_t * sin(phi), b, direction);
+		double c = dot(direction, nl);
+		if (c <= 0)
+			continue;                  /* sous la surface */
+
+		double t;
+		int touche;
+		nb_rayons++;
+		if (!render_intersect(sc, x, direction, &t, &touche) || touche != id)
+			continue;                  /* à l'ombre */
+		double p_l = 1 / (2 * M_PI * ouverture);
+		double p_b = c / M_PI;
+		/* (f cos / p_l) * p_l / (p_l + p_b), f = couleur / pi déjà dans throughput */
+		double e[3];
+		mul(throughput, L->emission, e);
+		axpy(p_b / (p_l + p_b), e, acc);
+	}
+	return nb_rayons;
+}
+
+/******************************* intégrateur *************************************/
+
+int render_task_depth;
+
+/* état d'une branche en attente : rayon réfracté mis de côté lors d'une séparation
+   réflexion/réfraction, avec son poids (throughput) et sa profondeur */
+struct branche {
+	double origin[3];
+	double direction[3];
+	double throughput[3];
+	int depth;
+	uint32_t branch;
+};
+
+/* calcule (dans out) la luminance reçue le long du rayon (ray_origin, ray_direction),
+   qui touche la sphère id à la distance t.
+
+   Version itérative de radiance_recursive() : au lieu de out = emission + f * rec,
+   on accumule throughput * emission à chaque rebond puis on multiplie throughput
+   par f. Pour les surfaces REFR en dessous de SPLIT_DEPTH, on continue avec le
+   rayon réfléchi et on empile le rayon réfracté ; il est repris quand le chemin
+   réfléchi se termine. Il y a au plus une séparation par niveau de profondeur,
+   donc au plus SPLIT_DEPTH branches en attente.
+
+   Les tirages aléatoires du rebond depth sont render_sampler->uniform4(path, depth, 0)
+   pour la branche courante : ils ne dépendent pas de l'ordre de parcours.
+
+   Avec render_nee, chaque rebond diffus ajoute l'éclairage direct (eclairage_direct) ;
+   l'émission touchée juste après un rebond diffus est alors pondérée par MIS.
+
+   Avec render_task_depth, dans une région parallèle, le rayon réfracté d'une
+   séparation jusqu'à cette profondeur n'est pas empilé : il est suivi par une tâche
+   OpenMP, qu'un thread sans travail peut prendre, et ajouté à la fin, après le
+   chemin et ses branches empilées (ordre fixe : le résultat ne dépend pas du
+   thread qui fait la tâche). Les séparations jusqu'à render_task_depth sont toutes
+   sur le chemin réfléchi de départ : au plus une tâche par profondeur. */
+int radiance_hit(const struct scene *sc, const double *ray_origin, const double *ray_direction, double t, int id,
+		int depth, const struct rng_path *path, double *out)
+{ 
+	struct branche pile[SPLIT_DEPTH];
+	int nb_branches = 0;
+	int nb_rayons = 0;
+	double acc_taches[SPLIT_DEPTH][3];      /* rayons réfractés confiés à des tâches */
+	int rayons_taches[SPLIT_DEPTH];
+	int nb_taches = 0;
+	bool taches = render_task_depth > 0 && omp_in_parallel();
+	struct rng_path chemin = *path;
+	double origin[3], direction[3];
+	double throughput[3] = {1, 1, 1};
+	double acc[3] = {0, 0, 0};
+	bool apres_diffus = false;              /* le rayon vient d'un rebond diffus avec --nee */
+	double x_diffus[3], p_diffus = 0;       /* point de ce rebond, densité de la direction */
+	copy(ray_origin, origin);
+	copy(ray_direction, direction);
+
+	for (;;) {
+		const struct Sphere *obj = &sc->spheres[id];
+		
+		/* point d'intersection du rayon et de la sphère */
+		double x[3];
+		copy(origin, x);
+		axpy(t, direction, x);
+		
+		/* vecteur normal à la sphere, au point d'intersection */
+		double n[3];  
+		copy(x, n);
+		axpy(-1, obj->position, n);
+		normalize(n);
+		
+		/* vecteur normal, orienté dans le sens opposé au rayon */
+		double nl[3];
+		copy(n, nl);
+		if (dot(n, direction) > 0)
+			scal(-1, nl);
+		
+		/* couleur de la sphere */
+		double f[3];
+		copy(obj->color, f);
+		double p = obj->max_reflexivity;
+
+		/* roulette russe au-delà de KILL_DEPTH */
+		bool vivant = true;
+		depth++;
+		double u[4];
+		render_sampler->uniform4(&chemin, depth, 0, u);
+		if (depth > KILL_DEPTH) {
+			if (u[0] < p)
+				scal(1 / p, f); 
+			else
+				vivant = false;
+		}
+
+		/* prend en compte l'émissivité, puis pondère la suite du chemin par la couleur */
+		double e[3];
+		mul(throughput, obj->emission, e);
+		double poids = 1;
+		if (apres_diffus && (e[0] > 0 || e[1] > 0 || e[2] > 0)) {
+			double ouverture = cone_ouverture(obj, x_diffus);
+			if (ouverture > 0)
+				poids = p_diffus / (p_diffus + 1 / (2 * M_PI * ouverture));
+		}
+		axpy(poids, e, acc);
+		mul(throughput, f, throughput);
+		apres_diffus = false;
+
+		if (vivant && obj->refl == DIFF) {
+			if (render_nee && (throughput[0] > 0 || throughput[1] > 0 || throughput[2] > 0)) {
+				nb_rayons += eclairage_direct(sc, id, x, nl, throughput, &chemin, depth, acc);
+				apres_diffus = true;
+				copy(x, x_diffus);
+				p_diffus = sqrt(1 - u[2]) / M_PI;    /* cos / pi */
+			}
+			/* direction aléatoire dans l'hémisphère (cf. radiance_recursive) */
+			double r1 = 2 * M_PI * u[1];
+			double r2 = u[2];
+			double r2s = sqrt(r2); 
+			double u[3], v[3];
+			double uw[3] = {0, 0, 0};
+			if (fabs(nl[0]) > .1)
+				uw[1] = 1;
+			else
+				uw[0] = 1;
+			cross(uw, nl, u);
+			normalize(u);
+			cross(nl, u, v);
+			zero(direction);
+			axpy(cos(r1) * r2s, u, direction);
+			axpy(sin(r1) * r2s, v, direction);
+			axpy(sqrt(1 - r2), nl, direction);
+			normalize(direction);
+		} else if (vivant) {
+			double reflected_dir[3];
+			copy(direction, reflected_dir);
+			axpy(-2 * dot(n, direction), n, reflected_dir);
+
+			if (obj->refl == REFR) {
+				bool into = dot(n, nl) > 0;      /* vient-il de l'extérieur ? */
+				double nc = 1;                   /* indice de réfraction de l'air */
+				double nt = 1.5;                 /* indice de réfraction du verre */
+				double nnt = into ? (nc / nt) : (nt / nc);
+				double ddn = dot(direction, nl);
+				double cos2t = 1 - nnt * nnt * (1 - ddn * ddn);
+				if (cos2t >= 0) {
+					double tdir[3];
+					zero(tdir);
+					axpy(nnt, direction, tdir);
+					axpy(-(into ? 1 : -1) * (ddn * nnt + sqrt(cos2t)), n, tdir);
+					double a = nt - nc;
+					double b = nt + nc;
+					double R0 = a * a / (b * b);
+					double c = 1 - (into ? -ddn : dot(tdir, n));
+					double Re = R0 + (1 - R0) * c * c * c * c * c;   /* réflectance */
+					double Tr = 1 - Re;                              /* transmittance */
+					if (depth > SPLIT_DEPTH) {
+						double P = .25 + .5 * Re;             /* probabilité de réflection */
+						if (u[3] < P) {
+							scal(Re / P, throughput);
+						} else {
+							scal(Tr / (1 - P), throughput);
+							copy(tdir, reflected_dir);
+						}
+					} else if (taches && depth <= render_task_depth) {
+						/* rayon réfracté dans une tâche, on continue avec le réfléchi */
+						struct rng_path refracte = chemin;
+						refracte.branch |= 1u << depth;
+						double poids_tr[3];
+						copy(throughput, poids_tr);
+						scal(Tr, poids_tr);
+						double *acc_tr = acc_taches[nb_taches];
+						int *rayons_tr = &rayons_taches[nb_taches];
+						nb_taches++;
+						#pragma omp task firstprivate(x, tdir, poids_tr, refracte, depth)
+						{
+							double rec[3];
+							*rayons_tr = radiance(sc, x, tdir, depth, &refracte, rec);
+							mul(poids_tr, rec, acc_tr);
+						}
+						scal(Re, throughput);
+					} else {
+						/* on met de côté le rayon réfracté, on continue avec le réfléchi */
+						struct branche *br = &pile[nb_branches++];
+						copy(x, br->origin);
+						copy(tdir, br->direction);
+						copy(throughput, br->throughput);
+						scal(Tr, br->throughput);
+						br->depth = depth;
+						br->branch = chemin.branch | (1u << depth);
+						scal(Re, throughput);
+					}
+				}
+				/* sinon réflexion totale : seulement le rayon réfléchi */
+			}
+			copy(reflected_dir, direction);
+		}
+		copy(x, origin);
+
+		/* rebond suivant ; si le chemin s'arrête, on reprend la dernière branche en attente */
+		for (;;) {
+			if (vivant) {
+				nb_rayons++;
+				if (render_intersect(sc, origin, direction, &t, &id))
+					break;
+			}
+			if (nb_branches == 0) {
+				if (nb_taches > 0) {
+					#pragma omp taskwait
+					for (int k = 0; k < nb_taches; k++) {
+						axpy(1, acc_taches[k], acc);
+						nb_rayons += rayons_taches[k];
+					}
+				}
+				copy(acc, out);
+				return nb_rayons;
+			}
+			struct branche *br = &pile[--nb_branches];
+			copy(br->origin, origin);
+			copy(br->direction, direction);
+			copy(br->throughput, throughput);
+			depth = br->depth;
+			chemin.branch = br->branch;
+			vivant = true;
+			apres_diffus = false;
+		}
+	}
+}
+
+/* calcule (dans out) la lumiance reçue par la camera sur le rayon donné */
+int radiance(const struct scene *sc, const double *ray_origin, const double *ray_direction, int depth,
+		const struct rng_path *path, double *out)
+{ 
+	int id = 0;                             // id de la sphère intersectée par le rayon
+	double t;                               // distance à l'intersection
+	if (!render_intersect(sc, ray_origin, ray_direction, &t, &id)) {
+		zero(out);    // if miss, return black 
+		return 1; 
+	}
+	return 1 + radiance_hit(sc, ray_origin, ray_direction, t, id, depth, path, out);
+}
+
+/******************************* pixel *************************************/
+
+int render_sample(const struct scene *sc, const struct camera *cam, int i, int j, int sub, int s, double *out)
+{
+	struct rng_path path = rng_path_init(i, j, sub, s);
+	double u[4];
+	render_sampler->uniform4(&path, 0, 0, u);
+	double ray_origin[3], ray_direction[3];
+	camera_ray(cam, i, j, sub >> 1, sub & 1, u, ray_origin, ray_direction);
+
+	/* estime la lumiance qui arrive sur la caméra par ce rayon */
+	return radiance(sc, ray_origin, ray_direction, 0, &path, out);
+}
+
+long long render_pixel(const struct scene *sc, const struct camera *cam, int i, int j, int samples, double *out)
+{
+	long long nb_rayons = 0;
+	/* calcule la luminance d'un pixel, avec sur-échantillonnage 2x2 */
+	double pixel_radiance[3] = {0, 0, 0};
+	for (int sub_i = 0; sub_i < 2; sub_i++) {
+		for (int sub_j = 0; sub_j < 2; sub_j++) {
+			double subpixel_radiance[3] = {0, 0, 0};
+			/* simulation de monte-carlo : on effectue plein de lancers de rayons et on moyenne */
+			for (int s = 0; s < samples; s++) { 
+				double sample_radiance[3];
+				nb_rayons += render_sample(sc, cam, i, j, 2 * sub_i + sub_j, s, sample_radiance);
+
+				/* fait la moyenne sur tous les rayons */
+				axpy(1. / samples, sample_radiance, subpixel_radiance);
+			}
+			clamp(subpixel_radiance); //S'assure que les coef de subpixel_radiance soient compris entre 0 et 1
+			/* fait la moyenne sur les 4 sous-pixels */
+			axpy(0.25, subpixel_radiance, pixel_radiance);
+		}
+	}
+	copy(pixel_radiance, out);
+	return nb_rayons;
+}
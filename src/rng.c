@@ -0,0 +1,157 @@
+/* Philox4x32-10 par lots : RNG_LANES chemins à la fois.
+ *
+ * Chaque voie fait exactement le calcul de philox4x32() (rng.h) ; les
+ * compteurs et les clés sont rangés en SoA. Le jeu d'instructions est
+ * choisi à la compilation comme dans scene.c : AVX-512 (16 voies par
+ * instruction), AVX2 (8), et la boucle scalaire sinon. La moitié haute
+ * des produits 32 x 32 bits vient de deux vpmuludq (voies paires et
+ * impaires), que le compilateur ne trouve pas tout seul (il passe par
+ * des multiplications 64 bits).
+ */
+#include <stdint.h>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "rng.h"
+
+#define RNG_LANES 16
+
+/* 10 tours de Philox sur RNG_LANES compteurs c0..c3 et clés k0, k1 (modifiés sur place) */
+static inline void philox_lanes(uint32_t *c0, uint32_t *c1, uint32_t *c2, uint32_t *c3,
+		uint32_t *k0, uint32_t *k1)
+{
+#if defined(__AVX512F__)
+	const __m512i m0 = _mm512_set1_epi32(PHILOX_M0);
+	const __m512i m1 = _mm512_set1_epi32(PHILOX_M1);
+	const __m512i w0 = _mm512_set1_epi32(PHILOX_W0);
+	const __m512i w1 = _mm512_set1_epi32(PHILOX_W1);
+	__m512i x0 = _mm512_loadu_si512(c0), x1 = _mm512_loadu_si512(c1);
+	__m512i x2 = _mm512_loadu_si512(c2), x3 = _mm512_loadu_si512(c3);
+	__m512i y0 = _mm512_loadu_si512(k0), y1 = _mm512_loadu_si512(k1);
+	for (int r = 0; r < 10; r++) {
+		/* moitiés hautes : voies paires directement, voies impaires après décalage */
+		__m512i h0 = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(_mm512_mul_epu32(x0, m0), 32),
+				_mm512_mul_epu32(_mm512_srli_epi64(x0, 32), m0));
+		__m512i h2 = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(_mm512_mul_epu32(x2, m1), 32),
+				_mm512_mul_epu32(_mm512_srli_epi64(x2, 32), m1));
+		__m512i n0 = _mm512_xor_si512(_mm512_xor_si512(h2, x1), y0);
+		__m512i n2 = _mm512_xor_si512(_mm512_xor_si512(h0, x3), y1);
+		x1 = _mm512_mullo_epi32(x2, m1);
+		x3 = _mm512_mullo_epi32(x0, m0);
+		x0 = n0;
+		x2 = n2;
+		y0 = _mm512_add_epi32(y0, w0);
+		y1 = _mm512_add_epi32(y1, w1);
+	}
+	_mm512_storeu_si512(c0, x0);
+	_mm512_storeu_si512(c1, x1);
+	_mm512_storeu_si512(c2, x2);
+	_mm512_storeu_si512(c3, x3);
+#elif defined(__AVX2__)
+	const __m256i m0 = _mm256_set1_epi32(PHILOX_M0);
+	const __m256i m1 = _mm256_set1_epi32(PHILOX_M1);
+	const __m256i w0 = _mm256_set1_epi32(PHILOX_W0);
+	const __m256i w1 = _mm256_set1_epi32(PHILOX_W1);
+	for (int l = 0; l < RNG_LANES; l += 8) {
+		__m256i x0 = _mm256_loadu_si256((__m256i *) (c0 + l)), x1 = _mm256_loadu_si256((__m256i *) (c1 + l));
+		__m256i x2 = _mm256_loadu_si256((__m256i *) (c2 + l)), x3 = _mm256_loadu_si256((__m256i *) (c3 + l));
+		__m256i y0 = _mm256_loadu_si256((__m256i *) (k0 + l)), y1 = _mm256_loadu_si256((__m256i *) (k1 + l));
+		for (int r = 0; r < 10; r++) {
+			__m256i h0 = _mm256_blend_epi32(_mm256_srli_epi64(_mm256_mul_epu32(x0, m0), 32),
+					_mm256_mul_epu32(_mm256_srli_epi64(x0, 32), m0), 0xAA);
+			__m256i h2 = _mm256_blend_epi32(_mm256_srli_epi64(_mm256_mul_epu32(x2, m1), 32),
+					_mm256_mul_epu32(_mm256_srli_epi64(x2, 32), m1), 0xAA);
+			__m256i n0 = _mm256_xor_si256(_mm256_xor_si256(h2, x1), y0);
+			__m256i n2 = _mm256_xor_si256(_mm256_xor_si256(h0, x3), y1);
+			x1 = _mm256_mullo_epi32(x2, m1);
+			x3 = _mm256_mullo_epi32(x0, m0);
+			x0 = n0;
+			x2 = n2;
+			y0 = _mm256_add_epi32(y0, w0);
+			y1 = _mm256_add_epi32(y1, w1);
+		}
+		_mm256_storeu_si256((__m256i *) (c0 + l), x0);
+		_mm256_storeu_si256((__m256i *) (c1 + l), x1);
+		_mm256_storeu_si256((__m256i *) (c2 + l), x2);
+		_mm256_storeu_si256((__m256i *) (c3 + l), x3);
+	}
+#else
+	for (int l = 0; l < RNG_LANES; l++) {
+		uint32_t ctr[4] = {c0[l], c1[l], c2[l], c3[l]}, key[2] = {k0[l], k1[l]}, x[4];
+		philox4x32(ctr, key, x);
+		c0[l] = x[0]; c1[l] = x[1]; c2[l] = x[2]; c3[l] = x[3];
+	}
+#endif
+}
+
+/* compteurs (sample, depth, branch, 0) et clés de RNG_LANES chemins, en SoA */
+static inline void charge_chemins(const struct rng_path *path, const int *depth,
+		uint32_t *c0, uint32_t *c1, uint32_t *c2, uint32_t *c3, uint32_t *k0, uint32_t *k1)
+{
+#if defined(__AVX512F__)
+	/* 16 chemins = 4 registres de (key0, key1, sample, branch) x 4 : transposition en deux étages */
+	_Static_assert(sizeof(struct rng_path) == 16, "struct rng_path : 4 entiers de 32 bits");
+	const uint32_t *p = (const uint32_t *) path;
+	__m512i a = _mm512_loadu_si512(p), b = _mm512_loadu_si512(p + 16);
+	__m512i c = _mm512_loadu_si512(p + 32), d = _mm512_loadu_si512(p + 48);
+	/* champs 0 et 1, puis 2 et 3, de 8 chemins */
+	const __m512i champs01 = _mm512_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28, 1, 5, 9, 13, 17, 21, 25, 29);
+	const __m512i champs23 = _mm512_add_epi32(champs01, _mm512_set1_epi32(2));
+	__m512i ab01 = _mm512_permutex2var_epi32(a, champs01, b), ab23 = _mm512_permutex2var_epi32(a, champs23, b);
+	__m512i cd01 = _mm512_permutex2var_epi32(c, champs01, d), cd23 = _mm512_permutex2var_epi32(c, champs23, d);
+	/* moitiés basses, puis hautes, des deux groupes de 8 */
+	const __m512i bas = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 16, 17, 18, 19, 20, 21, 22, 23);
+	const __m512i haut = _mm512_add_epi32(bas, _mm512_set1_epi32(8));
+	_mm512_storeu_si512(k0, _mm512_permutex2var_epi32(ab01, bas, cd01));
+	_mm512_storeu_si512(k1, _mm512_permutex2var_epi32(ab01, haut, cd01));
+	_mm512_storeu_si512(c0, _mm512_permutex2var_epi32(ab23, bas, cd23));
+	_mm512_storeu_si512(c2, _mm512_permutex2var_epi32(ab23, haut, cd23));
+	_mm512_storeu_si512(c1, _mm512_loadu_si512(depth));
+	_mm512_storeu_si512(c3, _mm512_setzero_si512());
+#else
+	for (int l = 0; l < RNG_LANES; l++) {
+		c0[l] = path[l].sample;
+		c1[l] = (uint32_t) depth[l];
+		c2[l] = path[l].branch;
+		c3[l] = 0;
+		k0[l] = path[l].key[0];
+		k1[l] = path[l].key[1];
+	}
+#endif
+}
+
+/* n lots de 4 uniformes : u[k] = rng_uniform4(&path[k], depth[k]) */
+void rng_uniform4_n(const struct rng_path *path, const int *depth, int n, double (*u)[4])
+{
+	for (int first = 0; first < n; first += RNG_LANES) {
+		int m = (n - first < RNG_LANES) ? n - first : RNG_LANES;
+		uint32_t c0[RNG_LANES], c1[RNG_LANES], c2[RNG_LANES], c3[RNG_LANES];
+		uint32_t k0[RNG_LANES], k1[RNG_LANES];
+
+		if (m == RNG_LANES) {
+			charge_chemins(path + first, depth + first, c0, c1, c2, c3, k0, k1);
+		} else {
+			/* voies inutilisées du dernier lot : copie du premier chemin, résultat ignoré */
+			for (int l = 0; l < RNG_LANES; l++) {
+				int k = first + (l < m ? l : 0);
+				c0[l] = path[k].sample;
+				c1[l] = (uint32_t) depth[k];
+				c2[l] = path[k].branch;
+				c3[l] = 0;
+				k0[l] = path[k].key[0];
+				k1[l] = path[k].key[1];
+			}
+		}
+
+		philox_lanes(c0, c1, c2, c3, k0, k1);
+
+		for (int l = 0; l < m; l++) {
+			u[first + l][0] = c0[l] * 0x1p-32;
+			u[first + l][1] = c1[l] * 0x1p-32;
+			u[first + l][2] = c2[l] * 0x1p-32;
+			u[first + l][3] = c3[l] * 0x1p-32;
+		}
+	}
+}
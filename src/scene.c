@@ -0,0 +1,472 @@
+/* Représentation SoA de la scène et test d'intersection vectoriel.
+ *
+ * Le jeu d'instructions est choisi à la compilation (-march=native dans le
+ * Makefile) : AVX-512 (8 sphères par instruction), AVX (4), SSE2 (2), et une
+ * boucle scalaire sur les tableaux SoA sinon.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pwd.h>       /* pour getpwuid */
+#include <sys/mman.h>
+#include <unistd.h>    /* pour getuid   */
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "bvh.h"
+#include "scene.h"
+
+static const double EPS = 1e-4;    /* distance minimale (évite l'auto-intersection) */
+static const double INF = 1e20;    /* "pas d'intersection" */
+
+/* taille totale du bloc pour n sphères (multiple de 64 octets) */
+static size_t scene_size(int n, int n_padded)
+{
+	size_t taille = SCENE_HEADER + 4 * (size_t) n_padded * sizeof(double) + n * sizeof(struct Sphere);
+	return (taille + 63) / 64 * 64;
+}
+
+void *scene_alloc(size_t taille)
+{
+	void *bloc;
+	if (posix_memalign(&bloc, 64, taille) != 0) {
+		perror("Impossible d'allouer la scène compilée");
+		exit(1);
+	}
+	return bloc;
+}
+
+/* grande scène : le parcours linéaire coûte plus cher que la BVH */
+static void scene_build_bvh(struct scene *sc)
+{
+	int n = sc->n;
+	double *radius = malloc(n * sizeof(double));
+	sc->bvh = malloc(sizeof(struct bvh));
+	if (radius == NULL || sc->bvh == NULL) {
+		perror("Impossible d'allouer la scène compilée");
+		exit(1);
+	}
+	for (int i = 0; i < n; i++)
+		radius[i] = sc->spheres[i].radius;
+	/* cache : $BVH_CACHE, ou /tmp/<utilisateur> comme l'image ; BVH_CACHE= (vide) le désactive */
+	const char *dir = getenv("BVH_CACHE");
+	char defaut[64];
+	if (dir == NULL) {
+		struct passwd *pass = getpwuid(getuid());
+		snprintf(defaut, sizeof(defaut), "/tmp/%s", pass ? pass->pw_name : "bvh");
+		dir = defaut;
+	}
+	if (dir[0] == '\0')
+		bvh_build(sc->bvh, sc->px, sc->py, sc->pz, radius, n);
+	else
+		bvh_build_cached(sc->bvh, dir, sc->px, sc->py, sc->pz, radius, n);
+	free(radius);
+}
+
+bool scene_attach(struct scene *sc, void *bloc, size_t taille, void *mapping)
+{
+	const struct scene_header *hd = bloc;
+	if (taille < SCENE_HEADER || memcmp(hd->magic, SCENE_MAGIC, 8) != 0 || hd->version != SCENE_VERSION
+			|| hd->sphere_size != sizeof(struct Sphere) || hd->n < 0
+			|| hd->n_padded != (hd->n + SCENE_PAD - 1) / SCENE_PAD * SCENE_PAD
+			|| hd->taille != taille || scene_size(hd->n, hd->n_padded) != taille)
+		return false;
+	int n_padded = hd->n_padded;
+	sc->n = hd->n;
+	sc->n_padded = n_padded;
+	sc->bloc = bloc;
+	sc->taille = taille;
+	sc->mapping = mapping;
+	sc->px = (double *) ((char *) bloc + SCENE_HEADER);
+	sc->py = sc->px + n_padded;
+	sc->pz = sc->py + n_padded;
+	sc->r2 = sc->pz + n_padded;
+	sc->spheres = (struct Sphere *) (sc->r2 + n_padded);
+	sc->bvh = NULL;
+	if (sc->n >= SCENE_BVH_MIN)
+		scene_build_bvh(sc);
+
+	/* liste des sphères émissives */
+	sc->nb_lumieres = 0;
+	sc->lumieres = malloc(sc->n * sizeof(int) + 1);
+	if (sc->lumieres == NULL) {
+		perror("Impossible d'allouer la liste des lumières");
+		exit(1);
+	}
+	for (int i = 0; i < sc->n; i++) {
+		const double *e = sc->spheres[i].emission;
+		if (e[0] > 0 || e[1] > 0 || e[2] > 0)
+			sc->lumieres[sc->nb_lumieres++] = i;
+	}
+	return true;
+}
+
+void scene_compile(struct scene *sc, const struct Sphere *spheres, int n)
+{
+	int n_padded = (n + SCENE_PAD - 1) / SCENE_PAD * SCENE_PAD;
+	size_t taille = scene_size(n, n_padded);
+	void *bloc = scene_alloc(taille);
+	memset(bloc, 0, taille);
+	struct scene_header *hd = bloc;
+	memcpy(hd->magic, SCENE_MAGIC, 8);
+	hd->version = SCENE_VERSION;
+	hd->sphere_size = sizeof(struct Sphere);
+	hd->n = n;
+	hd->n_padded = n_padded;
+	hd->taille = taille;
+
+	double *px = (double *) ((char *) bloc + SCENE_HEADER);
+	double *py = px + n_padded, *pz = py + n_padded, *r2 = pz + n_padded;
+	struct Sphere *mat = (struct Sphere *) (r2 + n_padded);
+	for (int i = 0; i < n_padded; i++) {
+		if (i < n) {
+			px[i] = spheres[i].position[0];
+			py[i] = spheres[i].position[1];
+			pz[i] = spheres[i].position[2];
+			r2[i] = spheres[i].radius * spheres[i].radius;
+		} else {
+			/* sphère de bourrage : le discriminant vaut toujours -inf */
+			px[i] = py[i] = pz[i] = 0;
+			r2[i] = -INFINITY;
+		}
+	}
+
+	/* précalcule la norme infinie des couleurs */
+	for (int i = 0; i < n; i++) {
+		mat[i] = spheres[i];
+		double *f = mat[i].color;
+		if ((f[0] > f[1]) && (f[0] > f[2]))
+			mat[i].max_reflexivity = f[0];
+		else if (f[1] > f[2])
+			mat[i].max_reflexivity = f[1];
+		else
+			mat[i].max_reflexivity = f[2];
+	}
+	scene_attach(sc, bloc, taille, NULL);
+}
+
+void scene_free(struct scene *sc)
+{
+	if (sc->bvh != NULL) {
+		bvh_free(sc->bvh);
+		free(sc->bvh);
+	}
+	free(sc->lumieres);
+	if (sc->mapping != NULL)
+		munmap(sc->mapping, sc->taille);
+	else
+		free(sc->bloc);
+	memset(sc, 0, sizeof(*sc));
+}
+
+const char *scene_simd_name(void)
+{
+#if defined(__AVX512F__)
+	return "AVX-512";
+#elif defined(__AVX__)
+	return "AVX";
+#elif defined(__SSE2__)
+	return "SSE2";
+#else
+	return "scalaire";
+#endif
+}
+
+/******************************* version scalaire (AoS) *************************************/
+
+// returns distance, 0 if nohit
+double sphere_intersect(const struct Sphere *s, const double *ray_origin, const double *ray_direction)
+{
+	double op[3];
+	// Solve t^2*d.d + 2*t*(o-p).d + (o-p).(o-p)-R^2 = 0
+	for (int i = 0; i < 3; i++)
+		op[i] = s->position[i] - ray_origin[i];
+	double b = op[0] * ray_direction[0] + op[1] * ray_direction[1] + op[2] * ray_direction[2];
+	double discriminant = b * b - (op[0] * op[0] + op[1] * op[1] + op[2] * op[2]) + s->radius * s->radius;
+	if (discriminant < 0)
+		return 0;   /* pas d'intersection */
+	else
+		discriminant = sqrt(discriminant);
+	/* détermine la plus petite solution positive (i.e. point d'intersection le plus proche, mais devant nous) */
+	double t = b - discriminant;
+	if (t > EPS) {
+		return t;
+	} else {
+		t = b + discriminant;
+		if (t > EPS)
+			return t;
+		else
+			return 0;  /* cas bizarre, racine double, etc. */
+	}
+}
+
+bool scene_intersect_scalar(const struct Sphere *spheres, int n, const double *ray_origin,
+		const double *ray_direction, double *t, int *id)
+{
+	*t = INF;
+	for (int i = 0; i < n; i++) {
+		double d = sphere_intersect(&spheres[i], ray_origin, ray_direction);
+		if ((d > 0) && (d < *t)) {
+			*t = d;
+			*id = i;
+		}
+	}
+	return *t < INF;
+}
+
+/******************************* version vectorielle (SoA) *************************************/
+
+/* réduction finale : plus petit t parmi les voies ; à t égal, le plus petit indice
+   (c'est la sphère que le parcours scalaire aurait retenue en premier) */
+static inline bool reduce_min(const double *tmin, const double *idmin, int lanes, double *t, int *id)
+{
+	double best = INF;
+	int best_id = -1;
+	for (int l = 0; l < lanes; l++) {
+		if (tmin[l] < best || (tmin[l] == best && best < INF && idmin[l] < best_id)) {
+			best = tmin[l];
+			best_id = idmin[l];
+		}
+	}
+	*t = best;
+	if (best < INF)
+		*id = best_id;
+	return best < INF;
+}
+
+#if defined(__AVX512F__)
+
+bool scene_intersect_linear(const struct scene *sc, const double *ray_origin, const double *ray_direction,
+		double *t, int *id)
+{
+	const __m512d ox = _mm512_set1_pd(ray_origin[0]);
+	const __m512d oy = _mm512_set1_pd(ray_origin[1]);
+	const __m512d oz = _mm512_set1_pd(ray_origin[2]);
+	const __m512d dx = _mm512_set1_pd(ray_direction[0]);
+	const __m512d dy = _mm512_set1_pd(ray_direction[1]);
+	const __m512d dz = _mm512_set1_pd(ray_direction[2]);
+	const __m512d zero = _mm512_setzero_pd();
+	const __m512d eps = _mm512_set1_pd(EPS);
+	const __m512d inf = _mm512_set1_pd(INF);
+	const __m512d step = _mm512_set1_pd(8);
+	__m512d idx = _mm512_set_pd(7, 6, 5, 4, 3, 2, 1, 0);
+	__m512d tmin = inf;
+	__m512d idmin = _mm512_set1_pd(-1);
+
+	for (int i = 0; i < sc->n_padded; i += 8) {
+		__m512d opx = _mm512_sub_pd(_mm512_load_pd(sc->px + i), ox);
+		__m512d opy = _mm512_sub_pd(_mm512_load_pd(sc->py + i), oy);
+		__m512d opz = _mm512_sub_pd(_mm512_load_pd(sc->pz + i), oz);
+		__m512d b = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(opx, dx), _mm512_mul_pd(opy, dy)), _mm512_mul_pd(opz, dz));
+		__m512d oo = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(opx, opx), _mm512_mul_pd(opy, opy)), _mm512_mul_pd(opz, opz));
+		__m512d det = _mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(b, b), oo), _mm512_load_pd(sc->r2 + i));
+		__mmask8 hit = _mm512_cmp_pd_mask(det, zero, _CMP_GE_OQ);
+		if (hit) {
+			__m512d sq = _mm512_sqrt_pd(_mm512_max_pd(det, zero));
+			__m512d t1 = _mm512_sub_pd(b, sq);
+			__m512d t2 = _mm512_add_pd(b, sq);
+			/* t1 s'il est devant nous, sinon t2, sinon pas d'intersection */
+			__m512d tt = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(t2, eps, _CMP_GT_OQ), inf, t2);
+			tt = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(t1, eps, _CMP_GT_OQ), tt, t1);
+			__mmask8 closer = _mm512_mask_cmp_pd_mask(hit, tt, tmin, _CMP_LT_OQ);
+			tmin = _mm512_mask_blend_pd(closer, tmin, tt);
+			idmin = _mm512_mask_blend_pd(closer, idmin, idx);
+		}
+		idx = _mm512_add_pd(idx, step);
+	}
+
+	double tl[8] __attribute__((aligned(64)));
+	double il[8] __attribute__((aligned(64)));
+	_mm512_store_pd(tl, tmin);
+	_mm512_store_pd(il, idmin);
+	return reduce_min(tl, il, 8, t, id);
+}
+
+#elif defined(__AVX__)
+
+bool scene_intersect_linear(const struct scene *sc, const double *ray_origin, const double *ray_direction,
+		double *t, int *id)
+{
+	const __m256d ox = _mm256_set1_pd(ray_origin[0]);
+	const __m256d oy = _mm256_set1_pd(ray_origin[1]);
+	const __m256d oz = _mm256_set1_pd(ray_origin[2]);
+	const __m256d dx = _mm256_set1_pd(ray_direction[0]);
+	const __m256d dy = _mm256_set1_pd(ray_direction[1]);
+	const __m256d dz = _mm256_set1_pd(ray_direction[2]);
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d eps = _mm256_set1_pd(EPS);
+	const __m256d inf = _mm256_set1_pd(INF);
+	const __m256d step = _mm256_set1_pd(4);
+	__m256d idx = _mm256_set_pd(3, 2, 1, 0);
+	__m256d tmin = inf;
+	__m256d idmin = _mm256_set1_pd(-1);
+
+	for (int i = 0; i < sc->n_padded; i += 4) {
+		__m256d opx = _mm256_sub_pd(_mm256_load_pd(sc->px + i), ox);
+		__m256d opy = _mm256_sub_pd(_mm256_load_pd(sc->py + i), oy);
+		__m256d opz = _mm256_sub_pd(_mm256_load_pd(sc->pz + i), oz);
+		__m256d b = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(opx, dx), _mm256_mul_pd(opy, dy)), _mm256_mul_pd(opz, dz));
+		__m256d oo = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(opx, opx), _mm256_mul_pd(opy, opy)), _mm256_mul_pd(opz, opz));
+		__m256d det = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(b, b), oo), _mm256_load_pd(sc->r2 + i));
+		__m256d hit = _mm256_cmp_pd(det, zero, _CMP_GE_OQ);
+		if (_mm256_movemask_pd(hit)) {
+			__m256d sq = _mm256_sqrt_pd(_mm256_max_pd(det, zero));
+			__m256d t1 = _mm256_sub_pd(b, sq);
+			__m256d t2 = _mm256_add_pd(b, sq);
+			__m256d tt = _mm256_blendv_pd(inf, t2, _mm256_cmp_pd(t2, eps, _CMP_GT_OQ));
+			tt = _mm256_blendv_pd(tt, t1, _mm256_cmp_pd(t1, eps, _CMP_GT_OQ));
+			__m256d closer = _mm256_and_pd(hit, _mm256_cmp_pd(tt, tmin, _CMP_LT_OQ));
+			tmin = _mm256_blendv_pd(tmin, tt, closer);
+			idmin = _mm256_blendv_pd(idmin, idx, closer);
+		}
+		idx = _mm256_add_pd(idx, step);
+	}
+
+	double tl[4] __attribute__((aligned(32)));
+	double il[4] __attribute__((aligned(32)));
+	_mm256_store_pd(tl, tmin);
+	_mm256_store_pd(il, idmin);
+	return reduce_min(tl, il, 4, t, id);
+}
+
+#elif defined(__SSE2__)
+
+/* pas de blendv en SSE2 : sélection par masques (a & ~m) | (b & m) */
+static inline __m128d select_pd(__m128d a, __m128d b, __m128d m)
+{
+	return _mm_or_pd(_mm_andnot_pd(m, a), _mm_and_pd(m, b));
+}
+
+bool scene_intersect_linear(const struct scene *sc, const double *ray_origin, const double *ray_direction,
+		double *t, int *id)
+{
+	const __m128d ox = _mm_set1_pd(ray_origin[0]);
+	const __m128d oy = _mm_set1_pd(ray_origin[1]);
+	const __m128d oz = _mm_set1_pd(ray_origin[2]);
+	const __m128d dx = _mm_set1_pd(ray_direction[0]);
+	const __m128d dy = _mm_set1_pd(ray_direction[1]);
+	const __m128d dz = _mm_set1_pd(ray_direction[2]);
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d eps = _mm_set1_pd(EPS);
+	const __m128d inf = _mm_set1_pd(INF);
+	const __m128d step = _mm_set1_pd(2);
+	__m128d idx = _mm_set_pd(1, 0);
+	__m128d tmin = inf;
+	__m128d idmin = _mm_set1_pd(-1);
+
+	for (int i = 0; i < sc->n_padded; i += 2) {
+		__m128d opx = _mm_sub_pd(_mm_load_pd(sc->px + i), ox);
+		__m128d opy = _mm_sub_pd(_mm_load_pd(sc->py + i), oy);
+		__m128d opz = _mm_sub_pd(_mm_load_pd(sc->pz + i), oz);
+		__m128d b = _mm_add_pd(_mm_add_pd(_mm_mul_pd(opx, dx), _mm_mul_pd(opy, dy)), _mm_mul_pd(opz, dz));
+		__m128d oo = _mm_add_pd(_mm_add_pd(_mm_mul_pd(opx, opx), _mm_mul_pd(opy, opy)), _mm_mul_pd(opz, opz));
+		__m128d det = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b, b), oo), _mm_load_pd(sc->r2 + i));
+		__m128d hit = _mm_cmpge_pd(det, zero);
+		if (_mm_movemask_pd(hit)) {
+			__m128d sq = _mm_sqrt_pd(_mm_max_pd(det, zero));
+			__m128d t1 = _mm_sub_pd(b, sq);
+			__m128d t2 = _mm_add_pd(b, sq);
+			__m128d tt = select_pd(inf, t2, _mm_cmpgt_pd(t2, eps));
+			tt = select_pd(tt, t1, _mm_cmpgt_pd(t1, eps));
+			__m128d closer = _mm_and_pd(hit, _mm_cmplt_pd(tt, tmin));
+			tmin = select_pd(tmin, tt, closer);
+			idmin = select_pd(idmin, idx, closer);
+		}
+		idx = _mm_add_pd(idx, step);
+	}
+
+	double tl[2] __attribute__((aligned(16)));
+	double il[2] __attribute__((aligned(16)));
+	_mm_store_pd(tl, tmin);
+	_mm_store_pd(il, idmin);
+	return reduce_min(tl, il, 2, t, id);
+}
+
+#else
+
+bool scene_intersect_linear(const struct scene *sc, const double *ray_origin, const double *ray_direction,
+		double *t, int *id)
+{
+	*t = INF;
+	for (int i = 0; i < sc->n; i++) {
+		double opx = sc->px[i] - ray_origin[0];
+		double opy = sc->py[i] - ray_origin[1];
+		double opz = sc->pz[i] - ray_origin[2];
+		double b = opx * ray_direction[0] + opy * ray_direction[1] + opz * ray_direction[2];
+		double det = b * b - (opx * opx + opy * opy + opz * opz) + sc->r2[i];
+		if (det < 0)
+			continue;
+		det = sqrt(det);
+		double d = (b - det > EPS) ? b - det : ((b + det > EPS) ? b + det : INF);
+		if (d < *t) {
+			*t = d;
+			*id = i;
+		}
+	}
+	return *t < INF;
+}
+
+#endif
+
+bool scene_intersect(const struct scene *sc, const double *ray_origin, const double *ray_direction,
+		double *t, int *id)
+{
+	if (sc->bvh != NULL)
+		return bvh_intersect(sc->bvh, ray_origin, ray_direction, t, id);
+	return scene_intersect_linear(sc, ray_origin, ray_direction, t, id);
+}
+
+/******************************* paquets et flux de rayons *************************************/
+
+#define STREAM_CHUNK 64     /* rayons traités ensemble (les t/id du bloc restent dans le cache L1) */
+
+/* boucle externe sur les sphères, boucle interne (vectorisée par le compilateur)
+   sur un bloc de rayons : le corps est sans branchement pour que chaque voie
+   suive son propre rayon. Une scène qui a une BVH est parcourue rayon par rayon :
+   tester toutes les sphères pour chaque rayon coûterait O(n) */
+void scene_intersect_stream(const struct scene *sc, int n, const double *ox, const double *oy, const double *oz,
+		const double *dx, const double *dy, const double *dz, double *restrict t, int *restrict id)
+{
+	if (sc->bvh != NULL) {
+		for (int k = 0; k < n; k++) {
+			double o[3] = {ox[k], oy[k], oz[k]}, d[3] = {dx[k], dy[k], dz[k]};
+			if (!bvh_intersect(sc->bvh, o, d, &t[k], &id[k]))
+				id[k] = -1;
+		}
+		return;
+	}
+	for (int k0 = 0; k0 < n; k0 += STREAM_CHUNK) {
+		const int k1 = (n - k0 < STREAM_CHUNK) ? n : k0 + STREAM_CHUNK;
+		for (int k = k0; k < k1; k++) {
+			t[k] = INF;
+			id[k] = -1;
+		}
+		for (int i = 0; i < sc->n; i++) {
+			const double px = sc->px[i], py = sc->py[i], pz = sc->pz[i], r2 = sc->r2[i];
+			for (int k = k0; k < k1; k++) {
+				double opx = px - ox[k];
+				double opy = py - oy[k];
+				double opz = pz - oz[k];
+				double b = opx * dx[k] + opy * dy[k] + opz * dz[k];
+				double det = b * b - (opx * opx + opy * opy + opz * opz) + r2;
+				double sq = sqrt(det > 0 ? det : 0);
+				double t1 = b - sq;
+				double t2 = b + sq;
+				double tt = (t1 > EPS) ? t1 : ((t2 > EPS) ? t2 : INF);
+				tt = (det >= 0) ? tt : INF;
+				bool closer = tt < t[k];
+				t[k] = closer ? tt : t[k];
+				id[k] = closer ? i : id[k];
+			}
+		}
+	}
+}
+
+void scene_intersect_packet(const struct scene *sc, struct ray_packet *p)
+{
+	scene_intersect_stream(sc, p->n, p->ox, p->oy, p->oz, p->dx, p->dy, p->dz, p->t, p->id);
+}
@@ -0,0 +1,131 @@
+/* Lecture et écriture des fichiers de scène (format texte et format binaire). */
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scene.h"
+
+/* la scène est composée uniquement de spheres */
+const struct Sphere scene_cornell[] = {
+// radius position,                         emission,     color,              material
+   {1e5,  { 1e5+1,  40.8,       81.6},      {},           {.75,  .25,  .25},  DIFF, -1}, // Left
+   {1e5,  {-1e5+99, 40.8,       81.6},      {},           {.25,  .25,  .75},  DIFF, -1}, // Right
+   {1e5,  {50,      40.8,       1e5},       {},           {.75,  .75,  .75},  DIFF, -1}, // Back
+   {1e5,  {50,      40.8,      -1e5 + 170}, {},           {},                 DIFF, -1}, // Front
+   {1e5,  {50,      1e5,        81.6},      {},           {0.75, .75,  .75},  DIFF, -1}, // Bottom
+   {1e5,  {50,     -1e5 + 81.6, 81.6},      {},           {0.75, .75,  .75},  DIFF, -1}, // Top
+   {16.5, {40,      16.5,       47},        {},           {.999, .999, .999}, SPEC, -1}, // Mirror
+   {16.5, {73,      46.5,       88},        {},           {.999, .999, .999}, REFR, -1}, // Glass
+   {10,   {15,      45,         112},       {},           {.999, .999, .999}, DIFF, -1}, // white ball
+   {15,   {16,      16,         130},       {},           {.999, .999, 0},    REFR, -1}, // big yellow glass
+   {7.5,  {40,      8,          120},        {},           {.999, .999, 0   }, REFR, -1}, // small yellow glass middle
+   {8.5,  {60,      9,          110},        {},           {.999, .999, 0   }, REFR, -1}, // small yellow glass right
+   {10,   {80,      12,         92},        {},           {0, .999, 0},       DIFF, -1}, // green ball
+   {600,  {50,      681.33,     81.6},      {12, 12, 12}, {},                 DIFF, -1},  // Light
+   {5,    {50,      75,         81.6},      {},           {0, .682, .999}, DIFF, -1}, // occlusion, mirror
+};
+
+const int scene_cornell_n = sizeof(scene_cornell) / sizeof(struct Sphere);
+
+/* format binaire : le fichier est le bloc de la scène compilée, projeté tel quel */
+static bool load_binary(struct scene *sc, int fd, const char *path)
+{
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < SCENE_HEADER)
+		return false;
+	void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapping == MAP_FAILED) {
+		perror(path);
+		exit(1);
+	}
+	if (!scene_attach(sc, mapping, st.st_size, mapping)) {
+		fprintf(stderr, "%s : fichier de scène binaire invalide (version ou architecture différente ?)\n", path);
+		exit(1);
+	}
+	return true;
+}
+
+static void load_text(struct scene *sc, FILE *f, const char *path)
+{
+	int n = 0, capacite = 64;
+	struct Sphere *spheres = malloc(capacite * sizeof(struct Sphere));
+	char ligne[1024];
+	for (int num = 1; fgets(ligne, sizeof(ligne), f) != NULL; num++) {
+		char *diese = strchr(ligne, '#');
+		if (diese != NULL)
+			*diese = '\0';
+		char matiere[16];
+		struct Sphere s = {0};
+		int lus = sscanf(ligne, "%lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %15s", &s.radius,
+				&s.position[0], &s.position[1], &s.position[2],
+				&s.emission[0], &s.emission[1], &s.emission[2],
+				&s.color[0], &s.color[1], &s.color[2], matiere);
+		if (lus <= 0)
+			continue;       /* ligne vide ou commentaire */
+		if (lus != 11) {
+			fprintf(stderr, "%s:%d : attendu « rayon px py pz ex ey ez r g b matériau »\n", path, num);
+			exit(1);
+		}
+		if (strcmp(matiere, "DIFF") == 0)
+			s.refl = DIFF;
+		else if (strcmp(matiere, "SPEC") == 0)
+			s.refl = SPEC;
+		else if (strcmp(matiere, "REFR") == 0)
+			s.refl = REFR;
+		else {
+			fprintf(stderr, "%s:%d : matériau « %s » inconnu (DIFF, SPEC ou REFR)\n", path, num, matiere);
+			exit(1);
+		}
+		if (n == capacite) {
+			capacite *= 2;
+			spheres = realloc(spheres, capacite * sizeof(struct Sphere));
+		}
+		if (spheres == NULL) {
+			perror("Impossible d'allouer la scène");
+			exit(1);
+		}
+		spheres[n++] = s;
+	}
+	scene_compile(sc, spheres, n);
+	free(spheres);
+}
+
+void scene_load(struct scene *sc, const char *path)
+{
+	if (path == NULL) {
+		scene_compile(sc, scene_cornell, scene_cornell_n);
+		return;
+	}
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		exit(1);
+	}
+	char magic[8];
+	if (read(fd, magic, 8) == 8 && memcmp(magic, SCENE_MAGIC, 8) == 0 && load_binary(sc, fd, path)) {
+		close(fd);
+		return;
+	}
+	close(fd);
+	FILE *f = fopen(path, "r");
+	if (f == NULL) {
+		perror(path);
+		exit(1);
+	}
+	load_text(sc, f, path);
+	fclose(f);
+}
+
+bool scene_save(const struct scene *sc, const char *path)
+{
+	FILE *f = fopen(path, "w");
+	if (f == NULL)
+		return false;
+	bool ok = fwrite(sc->bloc, sc->taille, 1, f) == 1;
+	return (fclose(f) == 0) && ok;
+}
@@ -0,0 +1,252 @@
+/* Réserve de tuiles et deques de Chase-Lev (voir tuiles.h). */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tuiles.h"
+
+/***************************** deque de Chase et Lev ************************************/
+
+void deque_init(struct deque *d, long capacite)
+{
+	atomic_init(&d->haut, 0);
+	atomic_init(&d->bas, 0);
+	d->capacite = (capacite > 0) ? capacite : 1;
+	d->t = malloc(d->capacite * sizeof(*d->t));
+	if (d->t == NULL) {
+		perror("Impossible d'allouer une file de tuiles");
+		exit(1);
+	}
+}
+
+void deque_free(struct deque *d)
+{
+	free((void *) d->t);
+	d->t = NULL;
+}
+
+void deque_push(struct deque *d, int x)
+{
+	long b = atomic_load_explicit(&d->bas, memory_order_relaxed);
+	atomic_store_explicit(&d->t[b % d->capacite], x, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&d->bas, b + 1, memory_order_relaxed);
+}
+
+bool deque_pop(struct deque *d, int *x)
+{
+	long b = atomic_load_explicit(&d->bas, memory_order_relaxed) - 1;
+	atomic_store_explicit(&d->bas, b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	long t = atomic_load_explicit(&d->haut, memory_order_relaxed);
+	if (t > b) {            /* vide */
+		atomic_store_explicit(&d->bas, b + 1, memory_order_relaxed);
+		return false;
+	}
+	*x = atomic_load_explicit(&d->t[b % d->capacite], memory_order_relaxed);
+	if (t < b)
+		return true;
+	/* dernier élément : on le dispute aux voleurs */
+	bool gagne = atomic_compare_exchange_strong_explicit(&d->haut, &t, t + 1,
+			memory_order_seq_cst, memory_order_relaxed);
+	atomic_store_explicit(&d->bas, b + 1, memory_order_relaxed);
+	return gagne;
+}
+
+int deque_vole(struct deque *d, int *x)
+{
+	long t = atomic_load_explicit(&d->haut, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	long b = atomic_load_explicit(&d->bas, memory_order_acquire);
+	if (t >= b)
+		return DEQUE_VIDE;
+	*x = atomic_load_explicit(&d->t[t % d->capacite], memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&d->haut, &t, t + 1,
+			memory_order_seq_cst, memory_order_relaxed))
+		return DEQUE_PERDU;
+	return DEQUE_OK;
+}
+
+/********************************* réserve de tuiles ************************************/
+
+enum tuiles_ordre tuiles_ordre = ORDRE_HILBERT;
+
+bool tuiles_ordre_cherche(const char *nom, enum tuiles_ordre *ordre)
+{
+	static const char *noms[] = {"lines", "morton", "hilbert"};
+	for (int k = 0; k < 3; k++)
+		if (strcmp(nom, noms[k]) == 0) {
+			*ordre = k;
+			return true;
+		}
+	return false;
+}
+
+/* point d de la courbe de Morton sur une grille 2^m x 2^m : bits pairs / impairs */
+static void morton(unsigned d, int *x, int *y)
+{
+	*x = *y = 0;
+	for (int b = 0; b < 16; b++) {
+		*x |= ((d >> (2 * b)) & 1) << b;
+		*y |= ((d >> (2 * b + 1)) & 1) << b;
+	}
+}
+
+/* point d de la courbe de Hilbert sur une grille n x n (n puissance de 2) */
+static void hilbert(int n, unsigned d, int *x, int *y)
+{
+	*x = *y = 0;
+	for (int s = 1; s < n; s *= 2) {
+		int rx = 1 & (d / 2);
+		int ry = 1 & (d ^ rx);
+		if (ry == 0) {          /* rotation du quadrant */
+			if (rx == 1) {
+				*x = s - 1 - *x;
+				*y = s - 1 - *y;
+			}
+			int t = *x;
+			*x = *y;
+			*y = t;
+		}
+		*x += s * rx;
+		*y += s * ry;
+		d /= 4;
+	}
+}
+
+void tuiles_init(struct tuiles *tp, int w, int h, int nb_deques)
+{
+	tp->w = w;
+	tp->h = h;
+	tp->tw = (tuiles_ordre == ORDRE_LIGNES) ? w : TUILE_TAILLE;
+	tp->th = (tuiles_ordre == ORDRE_LIGNES) ? 1 : TUILE_TAILLE;
+	tp->nx = (w + tp->tw - 1) / tp->tw;
+	tp->ny = (h + tp->th - 1) / tp->th;
+	tp->nb = tp->nx * tp->ny;
+	tp->ordre = malloc(tp->nb * sizeof(*tp->ordre));
+	tp->premier = malloc((tp->nb + 1) * sizeof(*tp->premier));
+	tp->nb_deques = nb_deques;
+	tp->deques = malloc(nb_deques * sizeof(*tp->deques));
+	if (tp->ordre == NULL || tp->premier == NULL || tp->deques == NULL) {
+		perror("Impossible d'allouer les files de tuiles");
+		exit(1);
+	}
+	for (int k = 0; k < nb_deques; k++)
+		deque_init(&tp->deques[k], tp->nb);
+
+	/* la courbe couvre un carré 2^m x 2^m ; on garde ses points dans la grille */
+	int n = 1;
+	while (n < tp->nx || n < tp->ny)
+		n *= 2;
+	int k = 0;
+	for (unsigned d = 0; d < (unsigned) n * n && k < tp->nb; d++) {
+		int x = d % n, y = d / n;
+		if (tuiles_ordre == ORDRE_MORTON)
+			morton(d, &x, &y);
+		else if (tuiles_ordre == ORDRE_HILBERT)
+			hilbert(n, d, &x, &y);
+		if (x < tp->nx && y < tp->ny)
+			tp->ordre[k++] = y * tp->nx + x;
+	}
+	tp->premier[0] = 0;
+	for (k = 0; k < tp->nb; k++) {
+		int x0, y0, x1, y1;
+		tuiles_pixels(tp, tp->ordre[k], &x0, &y0, &x1, &y1);
+		tp->premier[k + 1] = tp->premier[k] + (long) (x1 - x0) * (y1 - y0);
+	}
+}
+
+void tuiles_free(struct tuiles *tp)
+{
+	for (int k = 0; k < tp->nb_deques; k++)
+		deque_free(&tp->deques[k]);
+	free(tp->deques);
+	free(tp->ordre);
+	free(tp->premier);
+	tp->deques = NULL;
+}
+
+void tuiles_pixels(const struct tuiles *tp, int tuile, int *x0, int *y0, int *x1, int *y1)
+{
+	*x0 = (tuile % tp->nx) * tp->tw;
+	*y0 = (tuile / tp->nx) * tp->th;
+	*x1 = (*x0 + tp->tw < tp->w) ? *x0 + tp->tw : tp->w;
+	*y1 = (*y0 + tp->th < tp->h) ? *y0 + tp->th : tp->h;
+}
+
+void tuiles_pixel(const struct tuiles *tp, long p, int *i, int *j)
+{
+	/* position k de la tuile : premier[k] <= p < premier[k + 1] */
+	int a = 0, b = tp->nb;
+	while (b - a > 1) {
+		int m = (a + b) / 2;
+		if (tp->premier[m] <= p)
+			a = m;
+		else
+			b = m;
+	}
+	int x0, y0, x1, y1;
+	tuiles_pixels(tp, tp->ordre[a], &x0, &y0, &x1, &y1);
+	long r = p - tp->premier[a];
+	*i = y0 + r / (x1 - x0);
+	*j = x0 + r % (x1 - x0);
+}
+
+void tuiles_repartit(struct tuiles *tp, int debut, int fin, int n)
+{
+	for (int k = 0; k < n; k++) {
+		int a = debut + (long) (fin - debut) * k / n;
+		int b = debut + (long) (fin - debut) * (k + 1) / n;
+		/* poussées à l'envers : le propriétaire les prend dans l'ordre, les voleurs par la fin */
+		for (int pos = b - 1; pos >= a; pos--)
+			deque_push(&tp->deques[k], tp->ordre[pos]);
+	}
+}
+
+void tuiles_premier_contact(const struct tuiles *tp, int debut, int fin, int n, int k,
+		double *image, bool haut_en_bas)
+{
+	int a = debut + (long) (fin - debut) * k / n;
+	int b = debut + (long) (fin - debut) * (k + 1) / n;
+	for (int pos = a; pos < b; pos++) {
+		int x0, y0, x1, y1;
+		tuiles_pixels(tp, tp->ordre[pos], &x0, &y0, &x1, &y1);
+		for (int i = y0; i < y1; i++) {
+			int y = haut_en_bas ? tp->h - 1 - i : i;
+			memset(image + 3 * ((long) y * tp->w + x0), 0, 3 * (x1 - x0) * sizeof(*image));
+		}
+	}
+}
+
+bool tuiles_prend(struct tuiles *tp, int moi, unsigned *graine, int *tuile)
+{
+	if (moi >= 0 && deque_pop(&tp->deques[moi], tuile))
+		return true;
+	for (;;) {
+		bool perdu = false;
+		int v0 = tuiles_alea(graine) % tp->nb_deques;
+		for (int k = 0; k < tp->nb_deques; k++) {
+			int v = (v0 + k) % tp->nb_deques;
+			if (v == moi)
+				continue;
+			int r = deque_vole(&tp->deques[v], tuile);
+			if (r == DEQUE_OK)
+				return true;
+			perdu = perdu || (r == DEQUE_PERDU);
+		}
+		if (!perdu)
+			return false;
+	}
+}
+
+int tuiles_vole_moitie(struct tuiles *tp, unsigned *graine, int *tuiles, int max)
+{
+	long reste = 0;
+	for (int k = 0; k < tp->nb_deques; k++)
+		reste += deque_taille(&tp->deques[k]);
+	long n = (reste / 2 < max) ? reste / 2 : max;
+	int k = 0;
+	while (k < n && tuiles_prend(tp, -1, graine, &tuiles[k]))
+		k++;
+	return k;
+}